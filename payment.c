@@ -1,9 +1,27 @@
+#ifndef _WIN32
+#define _FILE_OFFSET_BITS 64
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include "payment.h"
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/file.h>
+#endif
+
 // Internal helpers (no header exposure)
 static int isValidPaymentID(const char *id) {
     if (!id || strlen(id) != 4) return 0;
@@ -70,29 +88,143 @@ static int read_date_ymd(const char *prompt, int *y, int *m, int *d) {
     }
 }
 
+// Copies at most outsz-1 bytes without splitting a UTF-8 character
 static void csv_safe_copy(const char *in, char *out, size_t outsz) {
     if (!in || !out || outsz == 0) return;
-    size_t len = strlen(in);
-    if (len > 0 && (in[0] == '=' || in[0] == '+' || in[0] == '-' || in[0] == '@')) {
-        if (outsz > 1) {
-            out[0] = '\'';
-            strncpy(out + 1, in, outsz - 2);
-            out[outsz - 1] = '\0';
-        }
-    } else {
-        strncpy(out, in, outsz - 1);
-        out[outsz - 1] = '\0';
+    size_t off = 0;
+    // A leading quote is quoted too so loading can always strip exactly one
+    if (in[0] == '=' || in[0] == '+' || in[0] == '-' || in[0] == '@' || in[0] == '\'') {
+        if (outsz < 2) { out[0] = '\0'; return; }
+        out[off++] = '\'';
     }
+    size_t n = utf8ClampLength(in, outsz - 1 - off);
+    memcpy(out + off, in, n);
+    out[off + n] = '\0';
+}
+
+// Reads a payer name into a Payment-sized field: drains an overlong line
+// and never leaves half a UTF-8 character at the end
+static int read_name(char *buf, size_t sz) {
+    if (!fgets(buf, (int)sz, stdin)) { buf[0] = '\0'; return 0; }
+    if (!strchr(buf, '\n')) {
+        int c, drained = 0;
+        while ((c = getchar()) != EOF && c != '\n') drained = 1;
+        utf8TrimIncomplete(buf);
+        if (drained) printf("Name too long, truncated to: %s\n", buf);
+    }
+    chomp(buf);
+    return 1;
 }
 
 #ifdef _WIN32
 #ifndef strcasecmp
 #define strcasecmp _stricmp
 #endif
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#endif
+
+// Exclusive advisory lock on a whole file, held across read-then-append
+static int lockWholeFile(FILE *fp, int lock) {
+#ifdef _WIN32
+    HANDLE h = (HANDLE)_get_osfhandle(_fileno(fp));
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    return lock ? LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &ov) != 0
+                : UnlockFileEx(h, 0, MAXDWORD, MAXDWORD, &ov) != 0;
+#else
+    return flock(fileno(fp), lock ? LOCK_EX : LOCK_UN) == 0;
+#endif
+}
+
+static int truncateFile(FILE *fp, long long size) {
+    fflush(fp);
+#ifdef _WIN32
+    return _chsize_s(_fileno(fp), size) == 0;
+#else
+    return ftruncate(fileno(fp), (off_t)size) == 0;
+#endif
+}
+
+// Minimal worker threads: runs fn(arg, i) for i in [0, n) and waits for all.
+typedef struct {
+    void (*fn)(void *arg, int index);
+    void *arg;
+    int index;
+} WorkerStart;
+
+#ifdef _WIN32
+static DWORD WINAPI workerEntry(LPVOID p) {
+    WorkerStart *w = (WorkerStart *)p;
+    w->fn(w->arg, w->index);
+    return 0;
+}
+#else
+static void *workerEntry(void *p) {
+    WorkerStart *w = (WorkerStart *)p;
+    w->fn(w->arg, w->index);
+    return NULL;
+}
+#endif
+
+static void runParallel(int n, void (*fn)(void *arg, int index), void *arg) {
+    if (n <= 1) { if (n == 1) fn(arg, 0); return; }
+    WorkerStart *starts = (WorkerStart *)malloc(sizeof(WorkerStart) * n);
+#ifdef _WIN32
+    HANDLE *threads = (HANDLE *)malloc(sizeof(HANDLE) * n);
+#else
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * n);
 #endif
+    char *started = (char *)calloc(n, 1);
+    if (!starts || !threads || !started) {
+        // Out of memory: do the work on the calling thread
+        for (int i = 0; i < n; i++) fn(arg, i);
+        free(starts); free(threads); free(started);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        starts[i].fn = fn;
+        starts[i].arg = arg;
+        starts[i].index = i;
+#ifdef _WIN32
+        threads[i] = CreateThread(NULL, 0, workerEntry, &starts[i], 0, NULL);
+        started[i] = threads[i] != NULL;
+#else
+        started[i] = pthread_create(&threads[i], NULL, workerEntry, &starts[i]) == 0;
+#endif
+        if (!started[i]) fn(arg, i);
+    }
+    for (int i = 0; i < n; i++) {
+        if (!started[i]) continue;
+#ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif
+    }
+    free(starts); free(threads); free(started);
+}
+
+int defaultThreadCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int n = (int)si.dwNumberOfProcessors;
+#else
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (n < 1) n = 1;
+    if (n > MAX_THREADS) n = MAX_THREADS;
+    return n;
+}
 
 Payment payments[MAX];
 int count = 0;
+const char *dataFile = "paymentinfo.csv";
 
 const char *serviceTypes[] = {
     "Internet",
@@ -117,12 +249,15 @@ int comparePayment(const void *a, const void *b) {
 }
 
 #ifndef UNIT_TEST
-int main() {
+int main(int argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "--file") == 0) dataFile = argv[2];
+    else if (argc > 1) return runBatchCommand(argc - 1, argv + 1);
+
     int choice;
-    loadCSV("paymentinfo.csv");
+    loadCSV(dataFile);
     do {
         displayMenu();
-        read_int_range("Enter your choice: ", 0, 6, &choice);
+        read_int_range("Enter your choice: ", 0, 9, &choice);
 
         switch (choice) {
             case 1: addPayment(); break;
@@ -139,6 +274,13 @@ int main() {
                 printf("E2E tests %s (rc=%d)\n", rc==0?"PASSED":"FAILED", rc);
                 break;
             }
+            case 7: duplicateReport(); break;
+            case 8: showAggregates(); break;
+            case 9: {
+                int mismatches = verifyAggregates(1);
+                printf("Verification: %d mismatching aggregate(s).\n", mismatches);
+                break;
+            }
             case 0: printf("Exiting program...\n"); break;
             default: printf("Invalid menu!\n");
         }
@@ -155,10 +297,61 @@ void displayMenu() {
     printf("4. Delete Payment\n");
     printf("5. Run Unit Tests\n");
     printf("6. Run E2E Tests\n");
+    printf("7. Duplicate Payment Report\n");
+    printf("8. Totals by Service / Month\n");
+    printf("9. Verify Totals (full recompute)\n");
     printf("0. Exit\n");
     printf("=====================================\n");
 }
 
+// Copies a field into a fixed-size member without splitting a UTF-8
+// character; returns 1 when the field had to be cut
+static int copyField(char *dst, size_t dstsz, const char *src) {
+    size_t len = strlen(src);
+    size_t n = utf8ClampLength(src, dstsz - 1);
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+    utf8TrimIncomplete(dst);
+    return n < len;
+}
+
+// 1 = parsed, 0 = malformed line, -1 = well-formed but invalid payment ID
+static int parsePaymentLine(const char *line, Payment *out) {
+    char buf[200];
+    snprintf(buf, sizeof(buf), "%s", line);
+    chomp(buf);
+    char *fields[5];
+    char *p = buf;
+    for (int f = 0; f < 4; f++) {
+        char *comma = strchr(p, ',');
+        if (!comma || comma == p) return 0;
+        *comma = '\0';
+        fields[f] = p;
+        p = comma + 1;
+    }
+    fields[4] = p;
+
+    // saveCSV quotes names that a spreadsheet would treat as a formula
+    char *name = fields[1];
+    if (name[0] == '\'' && name[1] && strchr("=+-@'", name[1])) name++;
+    copyField(out->paymentID, sizeof(out->paymentID), fields[0]);
+    if (copyField(out->payerName, sizeof(out->payerName), name))
+        printf("Warning: name of %s truncated to: %s\n", out->paymentID, out->payerName);
+    copyField(out->serviceType, sizeof(out->serviceType), fields[2]);
+
+    char *end = NULL;
+    out->amount = strtof(fields[3], &end);
+    if (end == fields[3] || *end != '\0') return 0;
+    char *date = fields[4];
+    while (isspace((unsigned char)*date)) date++;
+    size_t dateLen = strcspn(date, " \t");
+    if (dateLen == 0) return 0;
+    if (dateLen >= sizeof(out->paymentDate)) dateLen = sizeof(out->paymentDate) - 1;
+    memcpy(out->paymentDate, date, dateLen);
+    out->paymentDate[dateLen] = '\0';
+    return isValidPaymentID(out->paymentID) ? 1 : -1;
+}
+
 void loadCSV(const char *filename) {
     FILE *fp = fopen(filename, "r");
     if (!fp) {
@@ -169,20 +362,40 @@ void loadCSV(const char *filename) {
     while (fgets(line, sizeof(line), fp)) {
         if (count >= MAX) { printf("Warning: maximum records reached (%d). Extra rows ignored.\n", MAX); break; }
         Payment tmp;
-        if (sscanf(line, "%9[^,],%49[^,],%29[^,],%f,%14s",
-                   tmp.paymentID,
-                   tmp.payerName,
-                   tmp.serviceType,
-                   &tmp.amount,
-                   tmp.paymentDate) == 5) {
-            if (!isValidPaymentID(tmp.paymentID)) {
-                printf("Skipping invalid ID record: %s", line);
-                continue;
-            }
-            payments[count++] = tmp;
+        int rc = parsePaymentLine(line, &tmp);
+        if (rc < 0) {
+            printf("Skipping invalid ID record: %s", line);
+            continue;
         }
+        if (rc > 0) payments[count++] = tmp;
     }
     fclose(fp);
+    rebuildAggregates();
+}
+
+int loadPaymentFile(const char *filename, Payment **outRows) {
+    if (!outRows) return -1;
+    *outRows = NULL;
+    FILE *fp = fopen(filename, "r");
+    if (!fp) return -1;
+    int n = 0, cap = 0;
+    Payment *rows = NULL;
+    char line[200];
+    while (fgets(line, sizeof(line), fp)) {
+        Payment tmp;
+        if (parsePaymentLine(line, &tmp) <= 0) continue;
+        if (n == cap) {
+            int ncap = cap ? cap * 2 : 256;
+            Payment *grown = (Payment *)realloc(rows, sizeof(Payment) * ncap);
+            if (!grown) { free(rows); fclose(fp); return -1; }
+            rows = grown;
+            cap = ncap;
+        }
+        rows[n++] = tmp;
+    }
+    fclose(fp);
+    *outRows = rows;
+    return n;
 }
 
 void saveCSV(const char *filename) {
@@ -223,19 +436,242 @@ int daysInMonth(int year, int month) {
     return days[month - 1];
 }
 
+/*
+ * UTF-8 case folding. Every mapping in the fold table keeps the encoded
+ * length of the character, so folding never changes byte offsets and can
+ * run in place. Pure-ASCII runs are folded eight bytes at a time.
+ */
+typedef struct {
+    uint32_t lo, hi;
+    int32_t delta;
+    int8_t parity;   // -1 = every code point, 0/1 = only even/odd ones (paired upper/lower)
+} FoldRange;
+
+static const FoldRange foldTable[] = {
+    { 0x00C0, 0x00D6, 0x20, -1 },    // Latin-1 À..Ö
+    { 0x00D8, 0x00DE, 0x20, -1 },    // Ø..Þ
+    { 0x0100, 0x012F, 1, 0 },        // Latin Extended-A pairs
+    { 0x0132, 0x0137, 1, 0 },
+    { 0x0139, 0x0148, 1, 1 },
+    { 0x014A, 0x0177, 1, 0 },
+    { 0x0178, 0x0178, -0x79, -1 },   // Ÿ -> ÿ
+    { 0x0179, 0x017E, 1, 1 },
+    { 0x0370, 0x0373, 1, 0 },        // archaic Greek pairs
+    { 0x0376, 0x0376, 1, 0 },
+    { 0x037F, 0x037F, 0x74, -1 },
+    { 0x0386, 0x0386, 0x26, -1 },    // Greek Ά
+    { 0x0388, 0x038A, 0x25, -1 },    // Έ Ή Ί
+    { 0x038C, 0x038C, 0x40, -1 },    // Ό
+    { 0x038E, 0x038F, 0x3F, -1 },    // Ύ Ώ
+    { 0x0391, 0x03A1, 0x20, -1 },    // Greek
+    { 0x03A3, 0x03AB, 0x20, -1 },
+    { 0x03CF, 0x03CF, 8, -1 },
+    { 0x03D8, 0x03EF, 1, 0 },        // archaic Greek and Coptic pairs
+    { 0x03F4, 0x03F4, -0x3C, -1 },
+    { 0x03F7, 0x03F7, 1, -1 },
+    { 0x03F9, 0x03F9, -7, -1 },
+    { 0x03FA, 0x03FA, 1, -1 },
+    { 0x03FD, 0x03FF, -0x82, -1 },
+    { 0x0400, 0x040F, 0x50, -1 },    // Cyrillic
+    { 0x0410, 0x042F, 0x20, -1 },
+    { 0x0460, 0x0481, 1, 0 },        // historic Cyrillic pairs
+    { 0x048A, 0x04BF, 1, 0 },        // Ukrainian Ґ, Kazakh, Tatar, ...
+    { 0x04C0, 0x04C0, 0x0F, -1 },    // Ӏ
+    { 0x04C1, 0x04CE, 1, 1 },
+    { 0x04D0, 0x052F, 1, 0 },        // through Cyrillic Supplement
+    { 0x1E00, 0x1E95, 1, 0 },        // Latin Extended Additional (Vietnamese)
+    { 0x1EA0, 0x1EFF, 1, 0 },
+    { 0xFF21, 0xFF3A, 0x20, -1 },    // Fullwidth A..Z
+};
+
+uint32_t utf8FoldCodePoint(uint32_t cp) {
+    if (cp < 0x80) return (cp >= 'A' && cp <= 'Z') ? cp + 0x20 : cp;
+    if ((cp > 0x052F && cp < 0x1E00) || cp > 0xFF3A) return cp;   // e.g. Thai: no case
+    for (size_t i = 0; i < sizeof(foldTable) / sizeof(foldTable[0]); i++) {
+        const FoldRange *r = &foldTable[i];
+        if (cp < r->lo) break;
+        if (cp > r->hi) continue;
+        if (r->parity >= 0 && (int)(cp & 1) != r->parity) return cp;
+        return (uint32_t)((int32_t)cp + r->delta);
+    }
+    return cp;
+}
+
+// Decodes one character; invalid bytes decode as themselves with length 1
+static int utf8Decode(const unsigned char *s, size_t avail, uint32_t *cp) {
+    unsigned char c = s[0];
+    int len = c < 0x80 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+    if (len == 0 || (size_t)len > avail) { *cp = c; return 1; }
+    uint32_t v = len == 1 ? c : len == 2 ? (c & 0x1Fu) : len == 3 ? (c & 0x0Fu) : (c & 0x07u);
+    for (int i = 1; i < len; i++) {
+        if ((s[i] & 0xC0) != 0x80) { *cp = c; return 1; }
+        v = (v << 6) | (s[i] & 0x3Fu);
+    }
+    *cp = v;
+    return len;
+}
+
+static void utf8Encode(uint32_t cp, unsigned char *out, int len) {
+    if (len == 1) { out[0] = (unsigned char)cp; return; }
+    for (int i = len - 1; i > 0; i--) { out[i] = (unsigned char)(0x80 | (cp & 0x3F)); cp >>= 6; }
+    out[0] = (unsigned char)((len == 2 ? 0xC0 : len == 3 ? 0xE0 : 0xF0) | cp);
+}
+
+// Lowercases 8 ASCII bytes at once (no byte may have the high bit set)
+static uint64_t asciiFoldWord(uint64_t w) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    uint64_t geA = w + ones * (0x80 - 'A');
+    uint64_t gtZ = w + ones * (0x80 - 'Z' - 1);
+    return w | (((geA ^ gtZ) & (ones * 0x80)) >> 2);
+}
+
+size_t utf8FoldCase(const char *in, size_t len, char *out) {
+    const unsigned char *s = (const unsigned char *)in;
+    unsigned char *d = (unsigned char *)out;
+    size_t i = 0;
+    while (i < len) {
+        if (i + 8 <= len) {
+            uint64_t w;
+            memcpy(&w, s + i, 8);
+            if (!(w & 0x8080808080808080ULL)) {
+                w = asciiFoldWord(w);
+                memcpy(d + i, &w, 8);
+                i += 8;
+                continue;
+            }
+        }
+        if (s[i] < 0x80) {
+            d[i] = (unsigned char)((s[i] >= 'A' && s[i] <= 'Z') ? s[i] + 0x20 : s[i]);
+            i++;
+            continue;
+        }
+        uint32_t cp;
+        int n = utf8Decode(s + i, len - i, &cp);
+        // A stray byte is copied as is; folding it would invent a different one
+        uint32_t folded = n > 1 ? utf8FoldCodePoint(cp) : cp;
+        if (folded != cp) utf8Encode(folded, d + i, n);
+        else if (d != s) memcpy(d + i, s + i, (size_t)n);
+        i += (size_t)n;
+    }
+    return len;
+}
+
+size_t utf8ClampLength(const char *s, size_t maxBytes) {
+    size_t len = strlen(s);
+    if (len <= maxBytes) return len;
+    // Back up over continuation bytes so a character is never split
+    size_t cut = maxBytes;
+    while (cut > 0 && ((unsigned char)s[cut] & 0xC0) == 0x80) cut--;
+    return cut;
+}
+
+// Drops a trailing multibyte character that was cut short (e.g. by fgets)
+void utf8TrimIncomplete(char *s) {
+    size_t len = strlen(s), lead = len;
+    while (lead > 0 && len - lead < 4 && ((unsigned char)s[lead - 1] & 0xC0) == 0x80) lead--;
+    if (lead == 0) return;
+    unsigned char c = (unsigned char)s[lead - 1];
+    size_t need = (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 1;
+    if (need > len - (lead - 1)) s[lead - 1] = '\0';
+}
+
 void toLower(char *s) {
-    for (int i = 0; s[i]; i++) s[i] = tolower((unsigned char)s[i]);
+    utf8FoldCase(s, strlen(s), s);
 }
 
 int containsIgnoreCase(const char *text, const char *pattern) {
-    char lowerText[100], lowerPattern[50];
-    strncpy(lowerText, text, sizeof(lowerText));
-    strncpy(lowerPattern, pattern, sizeof(lowerPattern));
-    lowerText[sizeof(lowerText)-1] = '\0';
-    lowerPattern[sizeof(lowerPattern)-1] = '\0';
-    toLower(lowerText);
-    toLower(lowerPattern);
-    return strstr(lowerText, lowerPattern) != NULL;
+    size_t tlen = strlen(text), plen = strlen(pattern);
+    if (plen > tlen) return 0;
+    char tbuf[256], pbuf[256];
+    char *t = tlen < sizeof(tbuf) ? tbuf : (char *)malloc(tlen + 1);
+    char *p = plen < sizeof(pbuf) ? pbuf : (char *)malloc(plen + 1);
+    int found = 0;
+    if (t && p) {
+        utf8FoldCase(text, tlen, t);
+        utf8FoldCase(pattern, plen, p);
+        t[tlen] = '\0';
+        p[plen] = '\0';
+        found = strstr(t, p) != NULL;
+    }
+    if (t != tbuf) free(t);
+    if (p != pbuf) free(p);
+    return found;
+}
+
+/*
+ * Approximate substring matching (Myers' bit-parallel algorithm).
+ * Pattern and text are compared per case-folded character, so a typo in
+ * a multibyte (e.g. Thai) name costs one edit. ASCII characters use a
+ * direct mask table; the few non-ASCII characters of a pattern are kept
+ * in a short list.
+ */
+// Folded character at s; stray bytes map above U+10FFFF so they only ever
+// match the same stray byte, never a real character
+static uint32_t approxCharAt(const unsigned char *s, size_t avail, int *n) {
+    uint32_t cp;
+    *n = utf8Decode(s, avail, &cp);
+    if (*n == 1 && cp >= 0x80) return 0x110000 + cp;
+    return utf8FoldCodePoint(cp);
+}
+
+void approxCompile(ApproxPattern *ap, const char *pattern) {
+    if (!ap) return;
+    memset(ap, 0, sizeof(*ap));
+    if (!pattern) return;
+    const unsigned char *s = (const unsigned char *)pattern;
+    size_t len = strlen(pattern);
+    for (size_t i = 0; i < len && ap->length < APPROX_MAX_PATTERN; ) {
+        int n;
+        uint32_t cp = approxCharAt(s + i, len - i, &n);
+        i += (size_t)n;
+        uint64_t bit = (uint64_t)1 << ap->length++;
+        if (cp < 0x80) { ap->peq[cp] |= bit; continue; }
+        int k = 0;
+        while (k < ap->extraCount && ap->extraChar[k] != cp) k++;
+        if (k == ap->extraCount) { ap->extraChar[k] = cp; ap->extraMask[k] = 0; ap->extraCount++; }
+        ap->extraMask[k] |= bit;
+    }
+}
+
+// Smallest edit distance between the pattern and any substring of text,
+// or -1 if it is greater than maxDist.
+int approxDistance(const ApproxPattern *ap, const char *text, int maxDist) {
+    if (!ap || !text) return -1;
+    int m = ap->length;
+    if (m == 0) return 0;
+    uint64_t pv = ~(uint64_t)0, mv = 0;
+    uint64_t last = (uint64_t)1 << (m - 1);
+    int score = m, best = m;
+    const unsigned char *t = (const unsigned char *)text;
+    size_t len = strlen(text);
+    for (size_t i = 0; i < len; ) {
+        uint64_t eq = 0;
+        if (t[i] < 0x80) {
+            unsigned char c = t[i++];
+            eq = ap->peq[(c >= 'A' && c <= 'Z') ? c + 0x20 : c];
+        } else {
+            int n;
+            uint32_t cp = approxCharAt(t + i, len - i, &n);
+            i += (size_t)n;
+            for (int k = 0; k < ap->extraCount; k++)
+                if (ap->extraChar[k] == cp) { eq = ap->extraMask[k]; break; }
+        }
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & last) score++;
+        else if (mh & last) score--;
+        ph <<= 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        if (score < best) {
+            best = score;
+            if (best == 0) break;
+        }
+    }
+    return best <= maxDist ? best : -1;
 }
 
 int findServiceMatches(const char *input, int matchedIndexes[]) {
@@ -281,8 +717,7 @@ void addPayment() {
 
     do {
         printf("Enter Payer Name (First [Middle] Last): ");
-        fgets(payments[count].payerName, 50, stdin);
-        payments[count].payerName[strcspn(payments[count].payerName, "\n")] = '\0';
+        read_name(payments[count].payerName, sizeof(payments[count].payerName));
         if (strlen(payments[count].payerName) == 0)
             printf("Payer name cannot be empty!\n");
     } while (strlen(payments[count].payerName) == 0);
@@ -324,13 +759,171 @@ void addPayment() {
     sprintf(payments[count].paymentDate, "%04d-%02d-%02d", year, month, day);
 
     count++;
-    saveCSV("paymentinfo.csv");
+    aggregateAdd(&payments[count - 1]);
+    recordChange('I', &payments[count - 1]);
+    saveCSV(dataFile);
     printf("Payment added!\n");
 }
 
+/*
+ * Result ordering. Indexes are sorted rather than the rows themselves so a
+ * search never reorders the store; ties always fall back to comparePayment
+ * and then to the row position, so every ordering is total and stable.
+ */
+static int compareRowsBy(const Payment *rows, int a, int b, SortKey key, int descending) {
+    int c = comparePaymentBy(&rows[a], &rows[b], key);
+    if (descending) c = -c;   // only the key flips; tie-breaks stay ascending
+    if (c == 0 && key != SORT_BY_ID) c = comparePayment(&rows[a], &rows[b]);
+    if (c == 0) c = (a > b) - (a < b);
+    return c;
+}
+
+int comparePaymentBy(const Payment *a, const Payment *b, SortKey key) {
+    switch (key) {
+        case SORT_BY_AMOUNT: return (a->amount > b->amount) - (a->amount < b->amount);
+        case SORT_BY_DATE: return strcmp(a->paymentDate, b->paymentDate);
+        case SORT_BY_ID:
+        default: return comparePayment(a, b);
+    }
+}
+
+// Stable merge sort of int items with a context-aware comparator (qsort has no context pointer)
+static void mergeSortItems(int *items, int n, int (*cmp)(const void *ctx, int a, int b), const void *ctx) {
+    if (n < 2) return;
+    int *buf = (int *)malloc(sizeof(int) * n);
+    if (!buf) return;
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = lo + width < n ? lo + width : n;
+            int hi = lo + 2 * width < n ? lo + 2 * width : n;
+            int i = lo, j = mid, o = lo;
+            while (i < mid && j < hi)
+                buf[o++] = cmp(ctx, items[i], items[j]) <= 0 ? items[i++] : items[j++];
+            while (i < mid) buf[o++] = items[i++];
+            while (j < hi) buf[o++] = items[j++];
+        }
+        memcpy(items, buf, sizeof(int) * n);
+    }
+    free(buf);
+}
+
+typedef struct {
+    const Payment *rows;
+    SortKey key;
+    int descending;
+} RowOrder;
+
+static int compareRowOrder(const void *ctx, int a, int b) {
+    const RowOrder *o = (const RowOrder *)ctx;
+    return compareRowsBy(o->rows, a, b, o->key, o->descending);
+}
+
+void sortPaymentIndexes(const Payment *rows, int *indexes, int n, SortKey key, int descending) {
+    RowOrder order = { rows, key, descending };
+    mergeSortItems(indexes, n, compareRowOrder, &order);
+}
+
+// Top-K rank: > 0 when a is listed before b (key descending, ties ascending)
+static int rankRows(const Payment *rows, int a, int b, SortKey key) {
+    return compareRowsBy(rows, b, a, key, 1);
+}
+
+// Bounded min-heap helpers: heap[0] is the weakest of the current top K
+static void heapSiftDown(const Payment *rows, int *heap, int size, int i, SortKey key) {
+    while (1) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < size && rankRows(rows, heap[l], heap[m], key) < 0) m = l;
+        if (r < size && rankRows(rows, heap[r], heap[m], key) < 0) m = r;
+        if (m == i) return;
+        int t = heap[i]; heap[i] = heap[m]; heap[m] = t;
+        i = m;
+    }
+}
+
+static void heapSiftUp(const Payment *rows, int *heap, int i, SortKey key) {
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        if (rankRows(rows, heap[i], heap[p], key) >= 0) return;
+        int t = heap[i]; heap[i] = heap[p]; heap[p] = t;
+        i = p;
+    }
+}
+
+int topKPayments(const Payment *rows, int n, const char *serviceType, SortKey key, int k, int outIndexes[]) {
+    if (!rows || !outIndexes || k <= 0) return 0;
+    int size = 0;
+    for (int i = 0; i < n; i++) {
+        if (serviceType && strcasecmp(rows[i].serviceType, serviceType) != 0) continue;
+        if (size < k) {
+            outIndexes[size] = i;
+            heapSiftUp(rows, outIndexes, size++, key);
+        } else if (rankRows(rows, i, outIndexes[0], key) > 0) {
+            outIndexes[0] = i;
+            heapSiftDown(rows, outIndexes, size, 0, key);
+        }
+    }
+    // Pop the weakest to the back so the result ends up largest first
+    for (int end = size - 1; end > 0; end--) {
+        int t = outIndexes[0]; outIndexes[0] = outIndexes[end]; outIndexes[end] = t;
+        heapSiftDown(rows, outIndexes, end, 0, key);
+    }
+    return size;
+}
+
+static void printSelected(int idx) {
+    printf("\nSelected:\n%s | %s | %s | %.2f | %s\n",
+           payments[idx].paymentID, payments[idx].payerName,
+           payments[idx].serviceType, payments[idx].amount,
+           payments[idx].paymentDate);
+}
+
+// Pages through result indexes; distance (per row, optional) is shown for fuzzy hits
+static void browseResults(const int *indexes, int n, const int *distance) {
+    int offset = 0;
+    while (1) {
+        int end = offset + RESULT_PAGE_SIZE < n ? offset + RESULT_PAGE_SIZE : n;
+        if (n > RESULT_PAGE_SIZE) printf("\nResults %d-%d of %d\n", offset + 1, end, n);
+        for (int k = offset; k < end; k++) {
+            int i = indexes[k];
+            if (distance)
+                printf("%d) %s | %s (distance %d)\n", k+1, payments[i].paymentID, payments[i].payerName, distance[i]);
+            else
+                printf("%d) %s | %s | %s | %.2f | %s\n", k+1, payments[i].paymentID, payments[i].payerName,
+                       payments[i].serviceType, payments[i].amount, payments[i].paymentDate);
+        }
+
+        char line[64];
+        if (n > RESULT_PAGE_SIZE) printf("\nEnter number to view detail, n/p for next/previous page (0 cancel): ");
+        else printf("\nEnter number to view detail (0 cancel): ");
+        if (!read_line(line, sizeof(line))) return;
+        if (strcmp(line, "n") == 0 || strcmp(line, "N") == 0) {
+            if (end < n) offset = end; else printf("Already on the last page.\n");
+            continue;
+        }
+        if (strcmp(line, "p") == 0 || strcmp(line, "P") == 0) {
+            if (offset > 0) offset -= RESULT_PAGE_SIZE; else printf("Already on the first page.\n");
+            continue;
+        }
+        char *endp = NULL;
+        long sel = strtol(line, &endp, 10);
+        if (endp != line && *endp == '\0' && sel >= 0 && sel <= n) {
+            if (sel > 0) printSelected(indexes[sel-1]);
+            return;
+        }
+        printf("Invalid input! Please enter a number between 0 and %d.\n", n);
+    }
+}
+
+static int readSortKey(const char *prompt, SortKey *out) {
+    int key;
+    if (!read_int_range(prompt, 1, 3, &key)) return 0;
+    *out = key == 1 ? SORT_BY_ID : key == 2 ? SORT_BY_AMOUNT : SORT_BY_DATE;
+    return 1;
+}
+
 void searchPayment() {
     int choice;
-    read_int_range("Search by:\n1. Payment ID\n2. Payer Name\nChoose: ", 1, 2, &choice);
+    read_int_range("Search by:\n1. Payment ID\n2. Payer Name\n3. Payer Name (approximate)\n4. Top payments by service\nChoose: ", 1, 4, &choice);
 
     if (choice == 1) {
         char id[10];
@@ -355,28 +948,76 @@ void searchPayment() {
     else if (choice == 2) {
         char name[50];
         printf("Enter Payer Name (keyword): ");
-        fgets(name, 50, stdin);
-        name[strcspn(name, "\n")] = '\0';
+        read_name(name, sizeof(name));
 
         int foundIndexes[MAX], foundCount=0;
         for (int i=0; i<count; i++) {
-            if (containsIgnoreCase(payments[i].payerName, name)) {
-                printf("%d) %s | %s\n", foundCount+1, payments[i].paymentID, payments[i].payerName);
+            if (containsIgnoreCase(payments[i].payerName, name))
                 foundIndexes[foundCount++] = i;
-            }
         }
 
         if (!foundCount) { printf("No records found.\n"); return; }
+        if (foundCount > 1) {
+            SortKey key;
+            if (!readSortKey("Sort by:\n1. Payment ID\n2. Amount (highest first)\n3. Date (newest first)\nChoose: ", &key)) {
+                printf("Input error.\n");
+                return;
+            }
+            sortPaymentIndexes(payments, foundIndexes, foundCount, key, key != SORT_BY_ID);
+        }
+        browseResults(foundIndexes, foundCount, NULL);
+    }
+    else if (choice == 3) {
+        char name[50];
+        printf("Enter Payer Name (may contain typos): ");
+        if (!read_name(name, sizeof(name))) { printf("Input error.\n"); return; }
+        int maxDist;
+        if (!read_int_range("Max typos allowed (0-5): ", 0, 5, &maxDist)) { printf("Input error.\n"); return; }
 
-        int sel;
-        read_int_range("\nEnter number to view detail (0 cancel): ", 0, foundCount, &sel);
-        if (sel>0 && sel<=foundCount) {
-            int idx=foundIndexes[sel-1];
-            printf("\nSelected:\n%s | %s | %s | %.2f | %s\n",
-                   payments[idx].paymentID, payments[idx].payerName,
-                   payments[idx].serviceType, payments[idx].amount,
-                   payments[idx].paymentDate);
+        ApproxPattern ap;
+        approxCompile(&ap, name);
+        int dist[MAX], hits[MAX], perDist[6] = {0}, hitCount = 0;
+        for (int i=0; i<count; i++) {
+            dist[i] = approxDistance(&ap, payments[i].payerName, maxDist);
+            if (dist[i] >= 0) { perDist[dist[i]]++; hitCount++; }
+        }
+        if (!hitCount) { printf("No records found.\n"); return; }
+
+        // Rank by distance (counting sort keeps file order within a distance)
+        int start[6], pos = 0;
+        for (int d=0; d<=maxDist; d++) { start[d] = pos; pos += perDist[d]; }
+        for (int i=0; i<count; i++)
+            if (dist[i] >= 0) hits[start[dist[i]]++] = i;
+        browseResults(hits, hitCount, dist);
+    }
+    else if (choice == 4) {
+        char input[30];
+        const char *service = NULL;
+        printf("Enter Service Type keyword (blank = all services): ");
+        if (!read_line(input, sizeof(input))) { printf("Input error.\n"); return; }
+        if (input[0]) {
+            int matched[10], mc = findServiceMatches(input, matched);
+            if (mc == 0) { printf("No matching service type found.\n"); return; }
+            int sel = 1;
+            if (mc > 1) {
+                for (int x=0; x<mc; x++) printf("%d) %s\n", x+1, serviceTypes[matched[x]]);
+                if (!read_int_range("Select number: ", 1, mc, &sel)) { printf("Input error.\n"); return; }
+            }
+            service = serviceTypes[matched[sel-1]];
+        }
+        SortKey key;
+        int k;
+        if (!readSortKey("Rank by:\n1. Payment ID (highest)\n2. Amount (largest)\n3. Date (latest)\nChoose: ", &key) ||
+            !read_int_range("How many results (1-1000): ", 1, 1000, &k)) {
+            printf("Input error.\n");
+            return;
         }
+        int *top = (int *)malloc(sizeof(int) * k);
+        if (!top) { printf("Out of memory.\n"); return; }
+        int n = topKPayments(payments, count, service, key, k, top);
+        if (!n) printf("No records found.\n");
+        else browseResults(top, n, NULL);
+        free(top);
     } else printf("Invalid choice!\n");
 }
 
@@ -396,14 +1037,14 @@ void updatePayment() {
                 payments[i].serviceType, payments[i].amount,
                 payments[i].paymentDate);
 
+            Payment before = payments[i];
             int opt;
             do{
                 read_int_range("\n--- Update Menu ---\n1.Name\n2.Service\n3.Amount\n4.Date\n0.Finish\nChoose: ", 0, 4, &opt);
 
                 if(opt==1){
                     printf("Current: %s\nNew Name: ", payments[i].payerName);
-                    fgets(payments[i].payerName,50,stdin);
-                    payments[i].payerName[strcspn(payments[i].payerName,"\n")]='\0';
+                    read_name(payments[i].payerName, sizeof(payments[i].payerName));
                 }
                 else if(opt==2){
                     char input[30]; int matched[10],mc;
@@ -432,7 +1073,15 @@ void updatePayment() {
                 }
             }while(opt!=0);
 
-            saveCSV("paymentinfo.csv");
+            if (strcmp(before.payerName, payments[i].payerName) != 0 ||
+                strcmp(before.serviceType, payments[i].serviceType) != 0 ||
+                before.amount != payments[i].amount ||
+                strcmp(before.paymentDate, payments[i].paymentDate) != 0) {
+                aggregateRemove(&before);
+                aggregateAdd(&payments[i]);
+                recordChange('U', &payments[i]);
+            }
+            saveCSV(dataFile);
             printf("Changes saved!\n");
             return;
         }
@@ -445,14 +1094,1284 @@ void deletePayment() {
     if (!read_line(id, sizeof(id))) { printf("Input error.\n"); return; }
     for(int i=0;i<count;i++){
         if(strcasecmp(payments[i].paymentID,id)==0){
+            aggregateRemove(&payments[i]);
+            recordChange('D', &payments[i]);
             for(int j=i;j<count-1;j++) payments[j]=payments[j+1];
-            count--; saveCSV("paymentinfo.csv");
+            count--; saveCSV(dataFile);
             printf("Deleted.\n"); return;
         }
     }
     printf("Not found.\n");
 }
 
+/*
+ * Materialized aggregates per service type and per month (YYYY-MM).
+ * Mutations adjust count/sum in O(1) from the old and new row values.
+ * min/max also move in O(1) on insert; removing the current extreme marks
+ * the cell stale and it is rescanned once, the next time it is read.
+ */
+static AggregateCell serviceAgg[AGG_SERVICE_SLOTS];
+static AggregateCell monthAgg[AGG_MONTH_SLOTS];
+static int monthKeys[AGG_MONTH_SLOTS];   // year * 12 + (month - 1), -1 = free
+static int aggReady = 0;                 // views are built from the store on first use
+
+static int serviceAggIndex(const char *serviceType) {
+    for (int i = 0; i < serviceTypeCount && i < AGG_SERVICE_SLOTS - 1; i++)
+        if (strcasecmp(serviceTypes[i], serviceType) == 0) return i;
+    return AGG_SERVICE_SLOTS - 1;   // "Other"
+}
+
+static int monthKeyOf(const char *date) {
+    int y, m;
+    if (sscanf(date, "%d-%d", &y, &m) != 2 || y < 0 || m < 1 || m > 12) return -1;
+    return y * 12 + (m - 1);
+}
+
+// Slot for a month key in a linear-probing table; creates it when asked
+static int monthSlot(int *keys, int key, int create) {
+    if (key < 0) return -1;
+    int s = (int)(((unsigned int)key * 2654435761u) % AGG_MONTH_SLOTS);
+    for (int probe = 0; probe < AGG_MONTH_SLOTS; probe++) {
+        if (keys[s] == key) return s;
+        if (keys[s] == -1) {
+            if (!create) return -1;
+            keys[s] = key;
+            return s;
+        }
+        s = (s + 1) % AGG_MONTH_SLOTS;
+    }
+    return -1;
+}
+
+static void cellAdd(AggregateCell *c, float amount) {
+    if (c->count == 0 || amount < c->min) c->min = amount;
+    if (c->count == 0 || amount > c->max) c->max = amount;
+    c->count++;
+    c->sum += amount;
+}
+
+static void cellRemove(AggregateCell *c, float amount) {
+    if (c->count <= 0) return;
+    c->count--;
+    c->sum -= amount;
+    if (c->count == 0) { c->sum = 0.0; c->min = c->max = 0.0f; c->stale = 0; }
+    else if (amount <= c->min || amount >= c->max) c->stale = 1;
+}
+
+static void aggregateInto(AggregateCell *svc, AggregateCell *mon, int *keys, const Payment *p) {
+    cellAdd(&svc[serviceAggIndex(p->serviceType)], p->amount);
+    int s = monthSlot(keys, monthKeyOf(p->paymentDate), 1);
+    if (s >= 0) cellAdd(&mon[s], p->amount);
+}
+
+void aggregateAdd(const Payment *p) {
+    if (!aggReady) return;
+    aggregateInto(serviceAgg, monthAgg, monthKeys, p);
+}
+
+void aggregateRemove(const Payment *p) {
+    if (!aggReady) return;
+    cellRemove(&serviceAgg[serviceAggIndex(p->serviceType)], p->amount);
+    int s = monthSlot(monthKeys, monthKeyOf(p->paymentDate), 0);
+    if (s >= 0) cellRemove(&monthAgg[s], p->amount);
+}
+
+static void computeAggregates(AggregateCell *svc, AggregateCell *mon, int *keys) {
+    memset(svc, 0, sizeof(AggregateCell) * AGG_SERVICE_SLOTS);
+    memset(mon, 0, sizeof(AggregateCell) * AGG_MONTH_SLOTS);
+    for (int s = 0; s < AGG_MONTH_SLOTS; s++) keys[s] = -1;
+    for (int i = 0; i < count; i++) aggregateInto(svc, mon, keys, &payments[i]);
+}
+
+void rebuildAggregates(void) {
+    computeAggregates(serviceAgg, monthAgg, monthKeys);
+    aggReady = 1;
+}
+
+// Rescan min/max of a stale cell; serviceIndex < 0 means a month cell
+static void refreshCell(AggregateCell *c, int serviceIndex, int monthKey) {
+    if (!c->stale) return;
+    int seen = 0;
+    for (int i = 0; i < count; i++) {
+        const Payment *p = &payments[i];
+        if (serviceIndex >= 0 ? serviceAggIndex(p->serviceType) != serviceIndex
+                              : monthKeyOf(p->paymentDate) != monthKey) continue;
+        if (!seen || p->amount < c->min) c->min = p->amount;
+        if (!seen || p->amount > c->max) c->max = p->amount;
+        seen = 1;
+    }
+    c->stale = 0;
+}
+
+AggregateCell serviceAggregate(int serviceIndex) {
+    AggregateCell empty = { 0, 0.0, 0.0f, 0.0f, 0 };
+    if (!aggReady) rebuildAggregates();
+    if (serviceIndex < 0 || serviceIndex >= AGG_SERVICE_SLOTS) return empty;
+    refreshCell(&serviceAgg[serviceIndex], serviceIndex, -1);
+    return serviceAgg[serviceIndex];
+}
+
+AggregateCell monthAggregate(int year, int month) {
+    AggregateCell empty = { 0, 0.0, 0.0f, 0.0f, 0 };
+    if (!aggReady) rebuildAggregates();
+    int key = (month >= 1 && month <= 12) ? year * 12 + (month - 1) : -1;
+    int s = monthSlot(monthKeys, key, 0);
+    if (s < 0) return empty;
+    refreshCell(&monthAgg[s], -1, key);
+    return monthAgg[s];
+}
+
+static int compareInt(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// live is a raw maintained cell; until it is refreshed a stale cell only
+// has to bound the true extremes
+static int cellsDiffer(const AggregateCell *live, const AggregateCell *fresh) {
+    if (live->count != fresh->count) return 1;
+    if (live->count == 0) return 0;
+    double d = live->sum - fresh->sum;
+    if (d > 0.005 || d < -0.005) return 1;
+    if (live->stale) return live->min > fresh->min || live->max < fresh->max;
+    return live->min != fresh->min || live->max != fresh->max;
+}
+
+static const char *serviceAggName(int i) {
+    return i < serviceTypeCount && i < AGG_SERVICE_SLOTS - 1 ? serviceTypes[i] : "Other";
+}
+
+static void printCell(const char *label, const AggregateCell *c) {
+    printf("%-15s | count %d | sum %.2f | min %.2f | max %.2f\n", label, c->count, c->sum, c->min, c->max);
+}
+
+int verifyAggregates(int verbose) {
+    if (!aggReady) rebuildAggregates();
+    static AggregateCell svc[AGG_SERVICE_SLOTS], mon[AGG_MONTH_SLOTS];
+    static int keys[AGG_MONTH_SLOTS];
+    computeAggregates(svc, mon, keys);
+    int mismatches = 0;
+    // Raw cells, not the getters: refreshing would hide a missed stale mark
+    for (int i = 0; i < AGG_SERVICE_SLOTS; i++) {
+        AggregateCell live = serviceAgg[i];
+        if (!cellsDiffer(&live, &svc[i])) continue;
+        mismatches++;
+        if (verbose) {
+            printf("MISMATCH service %s\n", serviceAggName(i));
+            printCell("  maintained", &live);
+            printCell("  recomputed", &svc[i]);
+        }
+    }
+    // Compare in both directions so months missing from either side show up
+    for (int pass = 0; pass < 2; pass++) {
+        const int *from = pass == 0 ? keys : monthKeys;
+        for (int s = 0; s < AGG_MONTH_SLOTS; s++) {
+            if (from[s] < 0) continue;
+            int y = from[s] / 12, m = from[s] % 12 + 1;
+            int rs = monthSlot(keys, from[s], 0);
+            if (pass == 1 && rs >= 0) continue;   // already compared in pass 0
+            int ls = pass == 1 ? s : monthSlot(monthKeys, from[s], 0);
+            AggregateCell live = { 0, 0.0, 0.0f, 0.0f, 0 };
+            if (ls >= 0) live = monthAgg[ls];
+            AggregateCell fresh = { 0, 0.0, 0.0f, 0.0f, 0 };
+            if (rs >= 0) fresh = mon[rs];
+            if (!cellsDiffer(&live, &fresh)) continue;
+            mismatches++;
+            if (verbose) {
+                printf("MISMATCH month %04d-%02d\n", y, m);
+                printCell("  maintained", &live);
+                printCell("  recomputed", &fresh);
+            }
+        }
+    }
+    return mismatches;
+}
+
+void showAggregates(void) {
+    if (!aggReady) rebuildAggregates();
+    printf("\n===== Totals by Service Type =====\n");
+    for (int i = 0; i < AGG_SERVICE_SLOTS; i++) {
+        AggregateCell c = serviceAggregate(i);
+        if (i < serviceTypeCount || c.count > 0) printCell(serviceAggName(i), &c);
+    }
+    int keys[AGG_MONTH_SLOTS], n = 0;
+    for (int s = 0; s < AGG_MONTH_SLOTS; s++)
+        if (monthKeys[s] >= 0 && monthAgg[s].count > 0) keys[n++] = monthKeys[s];
+    qsort(keys, n, sizeof(int), compareInt);
+    printf("\n===== Totals by Month =====\n");
+    for (int k = 0; k < n; k++) {
+        char label[16];
+        snprintf(label, sizeof(label), "%04d-%02d", keys[k] / 12, keys[k] % 12 + 1);
+        AggregateCell c = monthAggregate(keys[k] / 12, keys[k] % 12 + 1);
+        printCell(label, &c);
+    }
+}
+
+/*
+ * Duplicate payment detection.
+ * Rows are keyed by normalized payer name + amount in cents and grouped in a
+ * hash table; only rows inside the same group are compared, and a group is
+ * scanned in date order so each row only meets neighbours inside the window.
+ * With threads > 1 the key space is split into hash partitions, each owned
+ * by one worker with its own table.
+ */
+typedef struct {
+    uint64_t hash;
+    long cents;
+    long day;
+    char name[50];
+} DupKey;
+
+typedef struct {
+    const Payment *rows;
+    int n;
+    int windowDays;
+    int parts;
+    DupKey *keys;
+    int *next;
+    int *byPart;                        // row indexes grouped by partition
+    int partStart[MAX_THREADS + 1];     // byPart[partStart[p] .. partStart[p+1]) belong to p
+    DuplicatePair *pairs[MAX_THREADS];
+    int pairCount[MAX_THREADS];
+    int failed[MAX_THREADS];            // one flag per partition, no shared writes
+} DupJob;
+
+// Days since 1970-01-01 for a valid YYYY-MM-DD date (2020 or later, as
+// read_date_ymd enforces, so the result is always positive)
+static int dateToDayNumber(const char *date, long *out) {
+    int y, m, d;
+    char tail;
+    if (!date || sscanf(date, "%d-%d-%d%c", &y, &m, &d, &tail) != 3) return 0;
+    if (y < 2020 || m < 1 || m > 12 || d < 1 || d > daysInMonth(y, m)) return 0;
+    long yy = y - (m <= 2);
+    long era = (yy >= 0 ? yy : yy - 399) / 400;
+    long yoe = yy - era * 400;
+    long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    *out = era * 146097 + doe - 719468;
+    return 1;
+}
+
+// Case-fold, trim and collapse inner whitespace so "john  DOE " == "John Doe"
+static void normalizeName(const char *in, char *out, size_t outsz) {
+    size_t o = 0;
+    int pendingSpace = 0;
+    for (; *in && o + 1 < outsz; in++) {
+        unsigned char c = (unsigned char)*in;
+        if (c < 0x80 && isspace(c)) { pendingSpace = o > 0; continue; }
+        if (pendingSpace && o + 2 < outsz) out[o++] = ' ';
+        pendingSpace = 0;
+        out[o++] = (char)c;
+    }
+    out[o] = '\0';
+    utf8TrimIncomplete(out);
+    toLower(out);
+}
+
+static void dupBuildKeys(void *arg, int index) {
+    DupJob *job = (DupJob *)arg;
+    int from = (int)((long long)job->n * index / job->parts);
+    int to = (int)((long long)job->n * (index + 1) / job->parts);
+    for (int i = from; i < to; i++) {
+        DupKey *k = &job->keys[i];
+        const Payment *p = &job->rows[i];
+        if (!dateToDayNumber(p->paymentDate, &k->day)) { k->cents = -1; continue; }
+        normalizeName(p->payerName, k->name, sizeof(k->name));
+        k->cents = (long)((double)p->amount * 100.0 + 0.5);
+        uint64_t h = 1469598103934665603ULL;  // FNV-1a
+        for (const char *c = k->name; *c; c++) { h ^= (unsigned char)*c; h *= 1099511628211ULL; }
+        h ^= (uint64_t)k->cents;
+        h *= 1099511628211ULL;
+        k->hash = h;
+    }
+}
+
+// Group members packed as (day << 32 | row) so a plain integer sort orders by date
+static int compareDayRow(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static int dupAppendPair(DupJob *job, int part, int *cap, int a, int b, int days) {
+    if (job->pairCount[part] == *cap) {
+        int ncap = *cap ? *cap * 2 : 64;
+        DuplicatePair *grown = (DuplicatePair *)realloc(job->pairs[part], sizeof(DuplicatePair) * ncap);
+        if (!grown) return 0;
+        job->pairs[part] = grown;
+        *cap = ncap;
+    }
+    DuplicatePair *dp = &job->pairs[part][job->pairCount[part]++];
+    dp->first = a < b ? a : b;
+    dp->second = a < b ? b : a;
+    dp->daysApart = days;
+    return 1;
+}
+
+static void dupScanPartition(void *arg, int part) {
+    DupJob *job = (DupJob *)arg;
+    const DupKey *keys = job->keys;
+    const int *rowsOfPart = job->byPart + job->partStart[part];
+    int members = job->partStart[part + 1] - job->partStart[part];
+    if (members == 0) return;
+
+    size_t slots = 16;
+    while (slots < (size_t)members * 2) slots <<= 1;
+    int *head = (int *)malloc(sizeof(int) * slots);
+    int *tail = (int *)malloc(sizeof(int) * slots);
+    long long *group = (long long *)malloc(sizeof(long long) * members);
+    if (!head || !tail || !group) { free(head); free(tail); free(group); job->failed[part] = 1; return; }
+    for (size_t s = 0; s < slots; s++) head[s] = -1;
+
+    // Chain every row onto its group (head/tail per slot, next per row)
+    for (int j = 0; j < members; j++) {
+        int i = rowsOfPart[j];
+        const DupKey *k = &keys[i];
+        size_t s = (size_t)(k->hash >> 8) & (slots - 1);
+        while (head[s] >= 0) {
+            const DupKey *g = &keys[head[s]];
+            if (g->hash == k->hash && g->cents == k->cents && strcmp(g->name, k->name) == 0) break;
+            s = (s + 1) & (slots - 1);
+        }
+        job->next[i] = -1;
+        if (head[s] < 0) head[s] = i;
+        else job->next[tail[s]] = i;
+        tail[s] = i;
+    }
+
+    int cap = 0;
+    for (size_t s = 0; s < slots && !job->failed[part]; s++) {
+        if (head[s] < 0 || job->next[head[s]] < 0) continue;
+        int m = 0;
+        for (int r = head[s]; r >= 0; r = job->next[r])
+            group[m++] = ((long long)keys[r].day << 32) | (unsigned int)r;
+        qsort(group, m, sizeof(long long), compareDayRow);
+        for (int a = 0; a < m; a++) {
+            int ra = (int)(group[a] & 0xffffffff);
+            for (int b = a + 1; b < m; b++) {
+                int rb = (int)(group[b] & 0xffffffff);
+                long gap = keys[rb].day - keys[ra].day;
+                if (gap > job->windowDays) break;
+                if (!dupAppendPair(job, part, &cap, ra, rb, (int)gap)) { job->failed[part] = 1; break; }
+            }
+        }
+    }
+    free(head); free(tail); free(group);
+}
+
+static int compareDuplicatePair(const void *a, const void *b) {
+    const DuplicatePair *pa = (const DuplicatePair *)a;
+    const DuplicatePair *pb = (const DuplicatePair *)b;
+    if (pa->first != pb->first) return pa->first - pb->first;
+    return pa->second - pb->second;
+}
+
+int findDuplicatePayments(const Payment *rows, int n, int windowDays, int threads, DuplicatePair **out) {
+    if (!out) return -1;
+    *out = NULL;
+    if (!rows || n <= 0) return 0;
+    if (windowDays < 0) windowDays = 0;
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    DupJob job;
+    memset(&job, 0, sizeof(job));
+    job.rows = rows;
+    job.n = n;
+    job.windowDays = windowDays;
+    job.parts = threads;
+    job.keys = (DupKey *)malloc(sizeof(DupKey) * n);
+    job.next = (int *)malloc(sizeof(int) * n);
+    job.byPart = (int *)malloc(sizeof(int) * n);
+    if (!job.keys || !job.next || !job.byPart) { free(job.keys); free(job.next); free(job.byPart); return -1; }
+
+    runParallel(threads, dupBuildKeys, &job);
+
+    // Bucket rows by partition once (counting sort), so each worker only
+    // touches its own rows and total work stays O(n)
+    int fill[MAX_THREADS] = {0};
+    for (int i = 0; i < n; i++)
+        if (job.keys[i].cents >= 0) job.partStart[job.keys[i].hash % (uint64_t)threads + 1]++;
+    for (int t = 0; t < threads; t++) job.partStart[t + 1] += job.partStart[t];
+    for (int i = 0; i < n; i++) {
+        if (job.keys[i].cents < 0) continue;
+        int p = (int)(job.keys[i].hash % (uint64_t)threads);
+        job.byPart[job.partStart[p] + fill[p]++] = i;
+    }
+
+    runParallel(threads, dupScanPartition, &job);
+
+    int total = 0, failed = 0;
+    for (int t = 0; t < threads; t++) { total += job.pairCount[t]; failed |= job.failed[t]; }
+    DuplicatePair *all = NULL;
+    if (!failed && total > 0) {
+        all = (DuplicatePair *)malloc(sizeof(DuplicatePair) * total);
+        if (all) {
+            int pos = 0;
+            for (int t = 0; t < threads; t++) {
+                if (job.pairCount[t]) memcpy(all + pos, job.pairs[t], sizeof(DuplicatePair) * job.pairCount[t]);
+                pos += job.pairCount[t];
+            }
+            qsort(all, total, sizeof(DuplicatePair), compareDuplicatePair);
+        }
+    }
+    for (int t = 0; t < threads; t++) free(job.pairs[t]);
+    free(job.keys);
+    free(job.next);
+    free(job.byPart);
+    if (failed || (total > 0 && !all)) return -1;
+    *out = all;
+    return total;
+}
+
+static void printDuplicateReport(const Payment *rows, int n, int windowDays, int threads) {
+    DuplicatePair *pairs = NULL;
+    int found = findDuplicatePayments(rows, n, windowDays, threads, &pairs);
+    if (found < 0) { printf("Duplicate report failed (out of memory).\n"); return; }
+    printf("\n===== Suspected Duplicate Payments (window %d days) =====\n", windowDays);
+    for (int i = 0; i < found; i++) {
+        const Payment *a = &rows[pairs[i].first], *b = &rows[pairs[i].second];
+        printf("%s | %s | %.2f | %s  <->  %s | %s (%d days apart)\n",
+               a->paymentID, a->payerName, a->amount, a->paymentDate,
+               b->paymentID, b->paymentDate, pairs[i].daysApart);
+    }
+    printf("%d suspected duplicate pair(s) in %d records.\n", found, n);
+    free(pairs);
+}
+
+void duplicateReport(void) {
+    int windowDays;
+    if (!read_int_range("Flag same payer + amount within how many days (0-365): ", 0, 365, &windowDays)) {
+        printf("Input error.\n");
+        return;
+    }
+    printDuplicateReport(payments, count, windowDays, 1);
+}
+
+/*
+ * Multi-ledger workspace. Every ledger file is loaded into its own row
+ * array; queries split each ledger into one row range per worker, so a
+ * single large branch file is shared across all threads as well.
+ */
+int openLedger(Ledger *lg, const char *filename) {
+    if (!lg || !filename) return 0;
+    memset(lg, 0, sizeof(*lg));
+    snprintf(lg->filename, sizeof(lg->filename), "%s", filename);
+    int n = loadPaymentFile(filename, &lg->rows);
+    if (n < 0) return 0;
+    lg->count = n;
+    lg->loaded = 1;
+    return 1;
+}
+
+void closeLedger(Ledger *lg) {
+    if (!lg) return;
+    free(lg->rows);
+    lg->rows = NULL;
+    lg->count = 0;
+    lg->loaded = 0;
+}
+
+typedef struct {
+    Ledger *ledgers;
+    const char *const *filenames;
+    int n;
+    int threads;
+    int *ok;
+} OpenJob;
+
+static void openLedgerWorker(void *arg, int index) {
+    OpenJob *job = (OpenJob *)arg;
+    for (int i = index; i < job->n; i += job->threads)
+        job->ok[i] = openLedger(&job->ledgers[i], job->filenames[i]);
+}
+
+int openWorkspace(Ledger *ledgers, const char *const filenames[], int n, int threads) {
+    if (!ledgers || n <= 0) return 0;
+    int *ok = (int *)calloc(n, sizeof(int));
+    if (!ok) return 0;
+    if (threads < 1) threads = 1;
+    if (threads > n) threads = n;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    OpenJob job = { ledgers, filenames, n, threads, ok };
+    runParallel(threads, openLedgerWorker, &job);
+    int opened = 0;
+    for (int i = 0; i < n; i++) opened += ok[i];
+    free(ok);
+    return opened;
+}
+
+static int ledgerQueryMatches(const Payment *p, const LedgerQuery *q) {
+    if (q->paymentID && strcasecmp(p->paymentID, q->paymentID) != 0) return 0;
+    if (q->serviceType && strcasecmp(p->serviceType, q->serviceType) != 0) return 0;
+    if (q->payerName && !containsIgnoreCase(p->payerName, q->payerName)) return 0;
+    return 1;
+}
+
+typedef struct {
+    const Ledger *ledgers;
+    int n;
+    int threads;
+    const LedgerQuery *query;
+    LedgerHit *hits[MAX_THREADS];
+    int hitCount[MAX_THREADS];
+    LedgerTotals *totals[MAX_THREADS];
+    int failed[MAX_THREADS];   // per worker, so no two threads write the same flag
+} FanoutJob;
+
+static void searchWorker(void *arg, int t) {
+    FanoutJob *job = (FanoutJob *)arg;
+    int cap = 0;
+    for (int l = 0; l < job->n; l++) {
+        const Ledger *lg = &job->ledgers[l];
+        int from = (int)((long long)lg->count * t / job->threads);
+        int to = (int)((long long)lg->count * (t + 1) / job->threads);
+        for (int r = from; r < to; r++) {
+            if (!ledgerQueryMatches(&lg->rows[r], job->query)) continue;
+            if (job->hitCount[t] == cap) {
+                int ncap = cap ? cap * 2 : 64;
+                LedgerHit *grown = (LedgerHit *)realloc(job->hits[t], sizeof(LedgerHit) * ncap);
+                if (!grown) { job->failed[t] = 1; return; }
+                job->hits[t] = grown;
+                cap = ncap;
+            }
+            job->hits[t][job->hitCount[t]].ledger = l;
+            job->hits[t][job->hitCount[t]].row = r;
+            job->hitCount[t]++;
+        }
+    }
+}
+
+typedef struct {
+    const Ledger *ledgers;
+    const LedgerHit *hits;
+    SortKey key;
+} HitOrder;
+
+static int compareHitOrder(const void *ctx, int a, int b) {
+    const HitOrder *o = (const HitOrder *)ctx;
+    const LedgerHit *ha = &o->hits[a], *hb = &o->hits[b];
+    const Payment *pa = &o->ledgers[ha->ledger].rows[ha->row];
+    const Payment *pb = &o->ledgers[hb->ledger].rows[hb->row];
+    int c = comparePaymentBy(pa, pb, o->key);
+    if (c == 0 && o->key != SORT_BY_ID) c = comparePayment(pa, pb);
+    if (c == 0) c = ha->ledger - hb->ledger;
+    if (c == 0) c = ha->row - hb->row;
+    return c;
+}
+
+int workspaceSearch(const Ledger *ledgers, int n, const LedgerQuery *query, SortKey key, int threads, LedgerHit **out) {
+    if (!out || !query) return -1;
+    *out = NULL;
+    if (!ledgers || n <= 0) return 0;
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    FanoutJob job;
+    memset(&job, 0, sizeof(job));
+    job.ledgers = ledgers;
+    job.n = n;
+    job.threads = threads;
+    job.query = query;
+    runParallel(threads, searchWorker, &job);
+
+    int total = 0, failed = 0;
+    for (int t = 0; t < threads; t++) { total += job.hitCount[t]; failed |= job.failed[t]; }
+    LedgerHit *all = NULL, *merged = NULL;
+    int *order = NULL;
+    if (!failed && total > 0) {
+        all = (LedgerHit *)malloc(sizeof(LedgerHit) * total);
+        merged = (LedgerHit *)malloc(sizeof(LedgerHit) * total);
+        order = (int *)malloc(sizeof(int) * total);
+    }
+    if (all && merged && order) {
+        int pos = 0;
+        for (int t = 0; t < threads; t++) {
+            if (job.hitCount[t]) memcpy(all + pos, job.hits[t], sizeof(LedgerHit) * job.hitCount[t]);
+            pos += job.hitCount[t];
+        }
+        for (int i = 0; i < total; i++) order[i] = i;
+        HitOrder ho = { ledgers, all, key };
+        mergeSortItems(order, total, compareHitOrder, &ho);
+        for (int i = 0; i < total; i++) merged[i] = all[order[i]];
+    } else {
+        free(merged);
+        merged = NULL;
+    }
+    free(all);
+    free(order);
+    for (int t = 0; t < threads; t++) free(job.hits[t]);
+    if (failed || (total > 0 && !merged)) return -1;
+    *out = merged;
+    return total;
+}
+
+static void totalsWorker(void *arg, int t) {
+    FanoutJob *job = (FanoutJob *)arg;
+    LedgerTotals *mine = job->totals[t];
+    for (int l = 0; l < job->n; l++) {
+        const Ledger *lg = &job->ledgers[l];
+        int from = (int)((long long)lg->count * t / job->threads);
+        int to = (int)((long long)lg->count * (t + 1) / job->threads);
+        for (int r = from; r < to; r++) {
+            float a = lg->rows[r].amount;
+            if (mine[l].count == 0 || a < mine[l].min) mine[l].min = a;
+            if (mine[l].count == 0 || a > mine[l].max) mine[l].max = a;
+            mine[l].count++;
+            mine[l].sum += a;
+        }
+    }
+}
+
+int workspaceTotals(const Ledger *ledgers, int n, int threads, LedgerTotals out[]) {
+    if (!ledgers || !out || n <= 0) return 0;
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    FanoutJob job;
+    memset(&job, 0, sizeof(job));
+    job.ledgers = ledgers;
+    job.n = n;
+    job.threads = threads;
+    int failed = 0;
+    for (int t = 0; t < threads; t++) {
+        job.totals[t] = (LedgerTotals *)calloc(n, sizeof(LedgerTotals));
+        if (!job.totals[t]) failed = 1;
+    }
+    if (!failed) runParallel(threads, totalsWorker, &job);
+
+    memset(out, 0, sizeof(LedgerTotals) * n);
+    for (int t = 0; t < threads && !failed; t++) {
+        for (int l = 0; l < n; l++) {
+            const LedgerTotals *part = &job.totals[t][l];
+            if (part->count == 0) continue;
+            if (out[l].count == 0 || part->min < out[l].min) out[l].min = part->min;
+            if (out[l].count == 0 || part->max > out[l].max) out[l].max = part->max;
+            out[l].count += part->count;
+            out[l].sum += part->sum;
+        }
+    }
+    for (int t = 0; t < threads; t++) free(job.totals[t]);
+    return !failed;
+}
+
+/*
+ * Change data capture. Every add/update/delete appends one line to
+ * "<ledger>.changes":
+ *     seq,op,paymentID,payerName,serviceType,amount,paymentDate
+ * where op is I, U or D and seq increases by one per change. Lines are
+ * only ever appended in seq order, so an export can binary-search the log
+ * for its starting point instead of reading it from the beginning.
+ */
+static void changeLogName(const char *data, char *out, size_t outsz) {
+    snprintf(out, outsz, "%s.changes", data);
+}
+
+// seq of a complete entry, or -1 for a torn or garbled line
+static long long parseChangeSeq(const char *line) {
+    if (!isdigit((unsigned char)line[0])) return -1;
+    char *end = NULL;
+    long long seq = strtoll(line, &end, 10);
+    if (seq <= 0 || end[0] != ',' || !end[1] || !strchr("IUD", end[1]) || end[2] != ',') return -1;
+    int commas = 0;
+    const char *c = end;
+    for (; *c && *c != '\n'; c++) commas += *c == ',';
+    // An entry is only complete once its newline is on disk
+    return (*c == '\n' && commas >= 6) ? seq : -1;
+}
+
+// Last well-formed seq in an open log. *completeEnd is set to the offset
+// just past the final newline; bytes after it are a torn write.
+static long long scanChangeLogTail(FILE *fp, long long *completeEnd) {
+    fseek64(fp, 0, SEEK_END);
+    long long size = ftell64(fp);
+    long long seq = 0, tailAt = -1;
+    // Walk back from the end to the last well-formed entry, widening the
+    // window if the tail is torn or garbled
+    for (long long window = 512; size > 0; window *= 8) {
+        long long from = size > window ? size - window : 0;
+        size_t len = (size_t)(size - from);
+        char *buf = (char *)malloc(len + 1);
+        if (!buf) break;
+        fseek64(fp, from, SEEK_SET);
+        len = fread(buf, 1, len, fp);
+        size_t end = len;
+        while (end > 0 && buf[end - 1] != '\n') end--;   // skip a torn last line
+        if (tailAt < 0 && (end > 0 || from == 0)) tailAt = from + (long long)end;
+        while (end > 0 && seq == 0) {
+            size_t start = end - 1;
+            while (start > 0 && buf[start - 1] != '\n') start--;
+            if (start == 0 && from > 0) break;   // line may begin before the window
+            char saved = buf[end];
+            buf[end] = '\0';
+            long long s = parseChangeSeq(buf + start);
+            buf[end] = saved;
+            if (s > 0) seq = s;
+            end = start;
+        }
+        free(buf);
+        if (seq > 0 || from == 0) break;
+    }
+    if (completeEnd) *completeEnd = tailAt < 0 ? size : tailAt;
+    return seq;
+}
+
+long long lastChangeSequence(const char *logFile) {
+    FILE *fp = fopen(logFile, "rb");
+    if (!fp) return 0;
+    long long seq = scanChangeLogTail(fp, NULL);
+    fclose(fp);
+    return seq;
+}
+
+int recordChange(char op, const Payment *p) {
+    char logFile[270];
+    changeLogName(dataFile, logFile, sizeof(logFile));
+    FILE *fp = fopen(logFile, "a+b");
+    if (!fp) {
+        printf("Cannot append to change log %s\n", logFile);
+        return 0;
+    }
+    // Locked from reading the last seq until the append is flushed, so two
+    // instances on the same ledger never stamp the same number
+    if (!lockWholeFile(fp, 1)) {
+        printf("Cannot lock change log %s\n", logFile);
+        fclose(fp);
+        return 0;
+    }
+    long long complete = 0;
+    long long seq = scanChangeLogTail(fp, &complete) + 1;
+    fseek64(fp, 0, SEEK_END);
+    long long size = ftell64(fp);
+    // Drop a torn last line rather than finishing it: one cut after its
+    // last comma would otherwise parse as an entry with a garbled date
+    int ok = 1;
+    if (complete < size) {
+        ok = truncateFile(fp, complete);
+        if (ok) printf("Dropped %lld byte(s) of an incomplete entry from %s\n", size - complete, logFile);
+        else printf("Cannot drop the incomplete entry at the end of %s\n", logFile);
+        fseek64(fp, 0, SEEK_END);
+    }
+    if (ok) {
+        char safeName[60];
+        char safeService[40];
+        csv_safe_copy(p->payerName, safeName, sizeof(safeName));
+        csv_safe_copy(p->serviceType, safeService, sizeof(safeService));
+        fprintf(fp, "%lld,%c,%s,%s,%s,%.2f,%s\n", seq, op,
+                p->paymentID, safeName, safeService, p->amount, p->paymentDate);
+        ok = fflush(fp) == 0;
+    }
+    lockWholeFile(fp, 0);
+    fclose(fp);
+    return ok;
+}
+
+// Offset of the first line starting at or after pos
+static long long lineStartAtOrAfter(FILE *fp, long long pos) {
+    if (pos == 0) return 0;
+    fseek64(fp, pos - 1, SEEK_SET);
+    int c;
+    while ((c = fgetc(fp)) != EOF && c != '\n') pos++;
+    return pos;
+}
+
+// Positions fp on the first entry whose seq is greater than since
+static void seekPastSequence(FILE *fp, long long since) {
+    fseek64(fp, 0, SEEK_END);
+    long long size = ftell64(fp);
+    long long lo = 0, hi = size;
+    char line[512];
+    while (lo < hi) {
+        long long mid = lo + (hi - lo) / 2;
+        long long start = lineStartAtOrAfter(fp, mid);
+        if (start >= size) { hi = mid; continue; }
+        fseek64(fp, start, SEEK_SET);
+        // Garbled lines are judged by the next well-formed entry after them
+        long long seq = -1;
+        while (seq < 0 && fgets(line, sizeof(line), fp)) seq = parseChangeSeq(line);
+        if (seq < 0 || seq > since) hi = mid;
+        else lo = start + 1;
+    }
+    fseek64(fp, lineStartAtOrAfter(fp, lo), SEEK_SET);
+}
+
+// Compact export line: full row for I/U, just the ID for D
+static void writeChangeLine(FILE *out, const char *entry) {
+    long long seq;
+    char op, id[10];
+    if (sscanf(entry, "%lld,%c,%9[^,\r\n]", &seq, &op, id) == 3 && op == 'D')
+        fprintf(out, "%lld,D,%s\n", seq, id);
+    else
+        fputs(entry, out);
+}
+
+typedef struct {
+    long long seq;
+    char entry[256];
+} LatestChange;
+
+static int compareLatestChange(const void *a, const void *b) {
+    long long x = ((const LatestChange *)a)->seq, y = ((const LatestChange *)b)->seq;
+    return (x > y) - (x < y);
+}
+
+long long exportChanges(const char *logFile, long long since, int compact, FILE *out, int *rowsOut) {
+    if (rowsOut) *rowsOut = 0;
+    FILE *fp = fopen(logFile, "rb");
+    if (!fp) return since;   // nothing recorded yet
+    seekPastSequence(fp, since);
+
+    // IDs are P001..P999, so "latest change per ID" needs at most 1000 slots
+    LatestChange *latest = compact ? (LatestChange *)calloc(1000, sizeof(LatestChange)) : NULL;
+    if (compact && !latest) { fclose(fp); return -1; }
+
+    long long highest = since;
+    int rows = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        long long seq = parseChangeSeq(line);
+        if (seq <= since) continue;
+        chomp(line);
+        strcat(line, "\n");
+        highest = seq;
+        if (!compact) { writeChangeLine(out, line); rows++; continue; }
+        char op, id[10];
+        if (sscanf(line, "%*[0-9],%c,%9[^,]", &op, id) != 2 || !isValidPaymentID(id)) continue;
+        int n = atoi(id + 1);
+        latest[n].seq = seq;
+        snprintf(latest[n].entry, sizeof(latest[n].entry), "%s", line);
+    }
+    fclose(fp);
+
+    if (compact) {
+        qsort(latest, 1000, sizeof(LatestChange), compareLatestChange);
+        for (int i = 0; i < 1000; i++) {
+            if (latest[i].seq == 0) continue;
+            writeChangeLine(out, latest[i].entry);
+            rows++;
+        }
+        free(latest);
+    }
+    if (rowsOut) *rowsOut = rows;
+    return highest;
+}
+
+/*
+ * Validate-only (lint) mode. The file is split into byte ranges, one per
+ * worker; each worker resyncs to the next line start and checks every line
+ * that starts inside its range against the rules addPayment enforces.
+ * Nothing is loaded into the store. Line numbers and duplicate IDs are
+ * resolved after all chunks finish, in file order.
+ */
+enum {
+    VAL_FIELD_COUNT,
+    VAL_LINE_TOO_LONG,
+    VAL_BAD_ID,
+    VAL_EMPTY_NAME,
+    VAL_NAME_TOO_LONG,
+    VAL_BAD_SERVICE,
+    VAL_BAD_AMOUNT,
+    VAL_AMOUNT_RANGE,
+    VAL_BAD_DATE,
+    VAL_DUPLICATE_ID
+};
+
+static const char *validationCodes[] = {
+    "FIELD_COUNT", "LINE_TOO_LONG", "BAD_ID", "EMPTY_NAME", "NAME_TOO_LONG",
+    "BAD_SERVICE", "BAD_AMOUNT", "AMOUNT_RANGE", "BAD_DATE", "DUPLICATE_ID"
+};
+
+typedef struct {
+    long long line;    // chunk-local until merged
+    int code;
+    int id;            // payment number for VAL_DUPLICATE_ID
+    char value[32];
+} ValidationError;
+
+typedef struct {
+    long long lines;
+    ValidationError *errors;
+    int errorCount;
+    int errorCap;
+    long long firstSeen[1000];   // chunk-local line of each payment number, 0 = unseen
+    int failed;
+} ValidationChunk;
+
+typedef struct {
+    const char *filename;
+    long long size;
+    int parts;
+    ValidationChunk *chunks;
+} ValidationJob;
+
+static void addValidationError(ValidationChunk *c, long long line, int code, int id, const char *value) {
+    if (c->errorCount == c->errorCap) {
+        int ncap = c->errorCap ? c->errorCap * 2 : 64;
+        ValidationError *grown = (ValidationError *)realloc(c->errors, sizeof(ValidationError) * ncap);
+        if (!grown) { c->failed = 1; return; }
+        c->errors = grown;
+        c->errorCap = ncap;
+    }
+    ValidationError *e = &c->errors[c->errorCount++];
+    e->line = line;
+    e->code = code;
+    e->id = id;
+    if (!value) value = "";
+    // Cut long values on a character boundary so the report stays valid UTF-8
+    size_t len = utf8ClampLength(value, sizeof(e->value) - 1);
+    memcpy(e->value, value, len);
+    e->value[len] = '\0';
+    // Keep the report machine-readable: no separators inside values
+    for (char *p = e->value; *p; p++) if (*p == ',' || *p == '"') *p = ' ';
+}
+
+static int isStrictDate(const char *s) {
+    if (strlen(s) != 10 || s[4] != '-' || s[7] != '-') return 0;
+    for (int i = 0; i < 10; i++) if (i != 4 && i != 7 && !isdigit((unsigned char)s[i])) return 0;
+    int y = atoi(s), m = atoi(s + 5), d = atoi(s + 8);
+    return y >= 2020 && m >= 1 && m <= 12 && d >= 1 && d <= daysInMonth(y, m);
+}
+
+static void validateLine(ValidationChunk *c, long long line, char *text) {
+    chomp(text);
+    if (text[0] == '\0') return;   // blank lines are ignored by loadCSV too
+    char *fields[6];
+    int nf = 0;
+    for (char *p = text; nf < 6; ) {
+        fields[nf++] = p;
+        char *comma = strchr(p, ',');
+        if (!comma) break;
+        *comma = '\0';
+        p = comma + 1;
+    }
+    if (nf != 5) { addValidationError(c, line, VAL_FIELD_COUNT, 0, fields[0]); return; }
+
+    int number = 0;
+    if (!parsePaymentNumber(fields[0], &number)) addValidationError(c, line, VAL_BAD_ID, 0, fields[0]);
+    else if (c->firstSeen[number]) addValidationError(c, line, VAL_DUPLICATE_ID, number, fields[0]);
+    else c->firstSeen[number] = line;
+
+    const char *name = fields[1];
+    if (name[0] == '\'' && name[1] && strchr("=+-@'", name[1])) name++;   // saveCSV's formula guard
+    size_t nameLen = strlen(name);
+    if (nameLen == 0) addValidationError(c, line, VAL_EMPTY_NAME, 0, "");
+    else if (nameLen >= sizeof(((Payment *)0)->payerName)) addValidationError(c, line, VAL_NAME_TOO_LONG, 0, name);
+
+    int known = 0;
+    for (int i = 0; i < serviceTypeCount && !known; i++) known = strcmp(fields[2], serviceTypes[i]) == 0;
+    if (!known) addValidationError(c, line, VAL_BAD_SERVICE, 0, fields[2]);
+
+    char *end = NULL;
+    float amount = strtof(fields[3], &end);
+    // Written so that "nan" fails the range check as well
+    if (end == fields[3] || *end != '\0') addValidationError(c, line, VAL_BAD_AMOUNT, 0, fields[3]);
+    else if (!(amount >= 1.0f && amount <= 10000.0f)) addValidationError(c, line, VAL_AMOUNT_RANGE, 0, fields[3]);
+
+    if (!isStrictDate(fields[4])) addValidationError(c, line, VAL_BAD_DATE, 0, fields[4]);
+}
+
+static void validateChunk(void *arg, int part) {
+    ValidationJob *job = (ValidationJob *)arg;
+    ValidationChunk *c = &job->chunks[part];
+    long long from = job->size * part / job->parts;
+    long long to = job->size * (part + 1) / job->parts;
+    FILE *fp = fopen(job->filename, "rb");
+    if (!fp) { c->failed = 1; return; }
+    setvbuf(fp, NULL, _IOFBF, 1 << 20);
+
+    long long pos = lineStartAtOrAfter(fp, from);
+    fseek64(fp, pos, SEEK_SET);
+    char line[1024];
+    while (pos < to && fgets(line, sizeof(line), fp)) {
+        size_t len = strlen(line);
+        pos += (long long)len;
+        c->lines++;
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n') {
+            int ch;
+            while ((ch = fgetc(fp)) != EOF) { pos++; if (ch == '\n') break; }
+            line[utf8ClampLength(line, 20)] = '\0';
+            addValidationError(c, c->lines, VAL_LINE_TOO_LONG, 0, line);
+            continue;
+        }
+        validateLine(c, c->lines, line);
+    }
+    fclose(fp);
+}
+
+static int compareValidationError(const void *a, const void *b) {
+    const ValidationError *x = (const ValidationError *)a, *y = (const ValidationError *)b;
+    if (x->line != y->line) return x->line < y->line ? -1 : 1;
+    return x->code - y->code;
+}
+
+long long validateCSVFile(const char *filename, int threads, FILE *report, long long *linesChecked) {
+    if (linesChecked) *linesChecked = 0;
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return -1;
+    fseek64(fp, 0, SEEK_END);
+    long long size = ftell64(fp);
+    fclose(fp);
+
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (size < (long long)threads * 4096) threads = 1;   // tiny files are not worth splitting
+    ValidationJob job = { filename, size, threads, NULL };
+    job.chunks = (ValidationChunk *)calloc(threads, sizeof(ValidationChunk));
+    if (!job.chunks) return -1;
+    runParallel(threads, validateChunk, &job);
+
+    // Turn chunk-local line numbers into file line numbers and resolve
+    // duplicate IDs across chunks in file order
+    long long total = 0, offset = 0;
+    long long *firstSeen = (long long *)calloc(1000, sizeof(long long));
+    int failed = !firstSeen;
+    for (int t = 0; t < threads && !failed; t++) {
+        ValidationChunk *c = &job.chunks[t];
+        for (int e = 0; e < c->errorCount; e++) c->errors[e].line += offset;
+        for (int id = 0; id < 1000; id++) {
+            if (!c->firstSeen[id]) continue;
+            long long line = c->firstSeen[id] + offset;
+            if (!firstSeen[id]) firstSeen[id] = line;
+            else {
+                char value[8];
+                snprintf(value, sizeof(value), "P%03d", id);
+                addValidationError(c, line, VAL_DUPLICATE_ID, id, value);
+            }
+        }
+        failed = c->failed;   // after the duplicate pass, which can grow the list too
+        offset += c->lines;
+        total += c->errorCount;
+    }
+
+    ValidationError *all = failed ? NULL : (ValidationError *)malloc(sizeof(ValidationError) * (total ? total : 1));
+    if (all) {
+        long long pos = 0;
+        for (int t = 0; t < threads; t++) {
+            if (job.chunks[t].errorCount) memcpy(all + pos, job.chunks[t].errors, sizeof(ValidationError) * job.chunks[t].errorCount);
+            pos += job.chunks[t].errorCount;
+        }
+        qsort(all, (size_t)total, sizeof(ValidationError), compareValidationError);
+        if (report) {
+            fprintf(report, "line,code,value,detail\n");
+            for (long long e = 0; e < total; e++) {
+                fprintf(report, "%lld,%s,%s,", all[e].line, validationCodes[all[e].code], all[e].value);
+                if (all[e].code == VAL_DUPLICATE_ID) fprintf(report, "first seen on line %lld", firstSeen[all[e].id]);
+                fprintf(report, "\n");
+            }
+        }
+    }
+    for (int t = 0; t < threads; t++) free(job.chunks[t].errors);
+    free(job.chunks);
+    free(firstSeen);
+    if (!all) return -1;
+    free(all);
+    if (linesChecked) *linesChecked = offset;
+    return total;
+}
+
+static void printBatchUsage(void) {
+    printf("Usage: payment [command] [options]\n");
+    printf("  (no command)                 interactive menu\n");
+    printf("  --file F                     interactive menu on ledger F\n");
+    printf("  duplicates [--file F] [--window DAYS] [--threads N]\n");
+    printf("  workspace search [--name KW] [--id ID] [--service S] [--sort id|amount|date] [--threads N] FILE...\n");
+    printf("  workspace totals [--threads N] FILE...\n");
+    printf("  totals [--file F] [--verify]\n");
+    printf("  validate FILE [--threads N] [--report OUT]\n");
+    printf("  export-changes [--file F] [--since SEQ | --checkpoint CK] [--compact] [--out OUT]\n");
+}
+
+// Parses "--name value" style integer options; returns 0 on a bad value
+static int batchIntOption(const char *value, int minv, int maxv, int *out) {
+    char *end = NULL;
+    long v = value ? strtol(value, &end, 10) : 0;
+    if (!value || !end || *end != '\0' || v < minv || v > maxv) return 0;
+    *out = (int)v;
+    return 1;
+}
+
+static int batchDuplicates(int argc, char *argv[]) {
+    const char *file = dataFile;
+    int windowDays = 3, threads = defaultThreadCount();
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--file") == 0 && value) { file = value; i++; }
+        else if (strcmp(argv[i], "--window") == 0 && batchIntOption(value, 0, 36500, &windowDays)) i++;
+        else if (strcmp(argv[i], "--threads") == 0 && batchIntOption(value, 1, MAX_THREADS, &threads)) i++;
+        else { printf("Invalid option: %s\n", argv[i]); printBatchUsage(); return 2; }
+    }
+    Payment *rows = NULL;
+    int n = loadPaymentFile(file, &rows);
+    if (n < 0) { printf("Cannot read %s\n", file); return 1; }
+    printDuplicateReport(rows, n, windowDays, threads);
+    free(rows);
+    return 0;
+}
+
+static int batchWorkspace(int argc, char *argv[]) {
+    if (argc < 2 || (strcmp(argv[1], "search") != 0 && strcmp(argv[1], "totals") != 0)) {
+        printBatchUsage();
+        return 2;
+    }
+    int search = strcmp(argv[1], "search") == 0;
+    LedgerQuery query = { NULL, NULL, NULL };
+    SortKey key = SORT_BY_ID;
+    int threads = defaultThreadCount(), i = 2;
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (search && strcmp(argv[i], "--name") == 0 && value) query.payerName = value;
+        else if (search && strcmp(argv[i], "--id") == 0 && value) query.paymentID = value;
+        else if (search && strcmp(argv[i], "--service") == 0 && value) query.serviceType = value;
+        else if (search && strcmp(argv[i], "--sort") == 0 && value) {
+            if (strcmp(value, "id") == 0) key = SORT_BY_ID;
+            else if (strcmp(value, "amount") == 0) key = SORT_BY_AMOUNT;
+            else if (strcmp(value, "date") == 0) key = SORT_BY_DATE;
+            else { printf("Invalid sort key: %s\n", value); return 2; }
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && batchIntOption(value, 1, MAX_THREADS, &threads)) {}
+        else { printf("Invalid option: %s\n", argv[i]); printBatchUsage(); return 2; }
+        i++;
+    }
+    int n = argc - i;
+    if (n <= 0) { printf("No ledger files given.\n"); return 2; }
+
+    Ledger *ledgers = (Ledger *)calloc(n, sizeof(Ledger));
+    if (!ledgers) { printf("Out of memory.\n"); return 1; }
+    openWorkspace(ledgers, (const char *const *)(argv + i), n, threads);
+    int rc = 0;
+    for (int l = 0; l < n; l++) {
+        if (!ledgers[l].loaded) {
+            printf("Cannot read %s\n", argv[i + l]);
+            rc = 1;
+        }
+    }
+
+    if (rc == 0 && search) {
+        LedgerHit *hits = NULL;
+        int found = workspaceSearch(ledgers, n, &query, key, threads, &hits);
+        if (found < 0) { printf("Search failed (out of memory).\n"); rc = 1; }
+        for (int h = 0; h < found; h++) {
+            const Payment *p = &ledgers[hits[h].ledger].rows[hits[h].row];
+            printf("%s | %s | %s | %s | %.2f | %s\n", ledgers[hits[h].ledger].filename,
+                   p->paymentID, p->payerName, p->serviceType, p->amount, p->paymentDate);
+        }
+        if (found >= 0) printf("%d record(s) found in %d ledger(s).\n", found, n);
+        free(hits);
+    } else if (rc == 0) {
+        LedgerTotals *totals = (LedgerTotals *)calloc(n, sizeof(LedgerTotals));
+        if (!totals || !workspaceTotals(ledgers, n, threads, totals)) { printf("Totals failed (out of memory).\n"); rc = 1; }
+        else {
+            LedgerTotals all = { 0, 0.0, 0.0f, 0.0f };
+            for (int l = 0; l < n; l++) {
+                printf("%s | %d records | sum %.2f | min %.2f | max %.2f\n", ledgers[l].filename,
+                       totals[l].count, totals[l].sum, totals[l].min, totals[l].max);
+                if (totals[l].count == 0) continue;
+                if (all.count == 0 || totals[l].min < all.min) all.min = totals[l].min;
+                if (all.count == 0 || totals[l].max > all.max) all.max = totals[l].max;
+                all.count += totals[l].count;
+                all.sum += totals[l].sum;
+            }
+            printf("ALL | %d records | sum %.2f | min %.2f | max %.2f\n", all.count, all.sum, all.min, all.max);
+        }
+        free(totals);
+    }
+    for (int l = 0; l < n; l++) closeLedger(&ledgers[l]);
+    free(ledgers);
+    return rc;
+}
+
+static int batchExportChanges(int argc, char *argv[]) {
+    const char *file = dataFile, *checkpoint = NULL, *outName = NULL;
+    long long since = -1;
+    int compact = 0;
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        char *end = NULL;
+        if (strcmp(argv[i], "--file") == 0 && value) { file = value; i++; }
+        else if (strcmp(argv[i], "--checkpoint") == 0 && value) { checkpoint = value; i++; }
+        else if (strcmp(argv[i], "--out") == 0 && value) { outName = value; i++; }
+        else if (strcmp(argv[i], "--compact") == 0) compact = 1;
+        else if (strcmp(argv[i], "--since") == 0 && value && (since = strtoll(value, &end, 10)) >= 0 && *end == '\0') i++;
+        else { printf("Invalid option: %s\n", argv[i]); printBatchUsage(); return 2; }
+    }
+    if (since < 0 && checkpoint) {
+        FILE *ck = fopen(checkpoint, "r");
+        if (!ck || fscanf(ck, "%lld", &since) != 1 || since < 0) since = 0;
+        if (ck) fclose(ck);
+    }
+    if (since < 0) since = 0;
+
+    FILE *out = outName ? fopen(outName, "w") : stdout;
+    if (!out) { printf("Cannot write %s\n", outName); return 1; }
+    char logFile[270];
+    changeLogName(file, logFile, sizeof(logFile));
+    int rows = 0;
+    long long highest = exportChanges(logFile, since, compact, out, &rows);
+    int ok = highest >= 0 && fflush(out) == 0;
+    if (outName) ok = (fclose(out) == 0) && ok;
+    if (!ok) { fprintf(stderr, "Export failed.\n"); return 1; }
+
+    // Advance the checkpoint only after the rows were written out
+    if (checkpoint) {
+        char tmpname[280];
+        snprintf(tmpname, sizeof(tmpname), "%s.tmp", checkpoint);
+        FILE *ck = fopen(tmpname, "w");
+        if (!ck) { fprintf(stderr, "Cannot write checkpoint %s\n", tmpname); return 1; }
+        fprintf(ck, "%lld\n", highest);
+        fclose(ck);
+        remove(checkpoint);
+        if (rename(tmpname, checkpoint) != 0) { fprintf(stderr, "Cannot update checkpoint %s\n", checkpoint); return 1; }
+    }
+    fprintf(stderr, "Exported %d change(s) after seq %lld, now at seq %lld.\n", rows, since, highest);
+    return 0;
+}
+
+static int batchTotals(int argc, char *argv[]) {
+    const char *file = dataFile;
+    int verify = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--file") == 0 && i + 1 < argc) file = argv[++i];
+        else if (strcmp(argv[i], "--verify") == 0) verify = 1;
+        else { printf("Invalid option: %s\n", argv[i]); printBatchUsage(); return 2; }
+    }
+    loadCSV(file);
+    int mismatches = verify ? verifyAggregates(1) : 0;
+    showAggregates();
+    if (verify) printf("\nVerification: %d mismatching aggregate(s).\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+static int batchValidate(int argc, char *argv[]) {
+    const char *file = NULL, *reportName = NULL;
+    int threads = defaultThreadCount();
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--report") == 0 && value) { reportName = value; i++; }
+        else if (strcmp(argv[i], "--threads") == 0 && batchIntOption(value, 1, MAX_THREADS, &threads)) i++;
+        else if (!file && strncmp(argv[i], "--", 2) != 0) file = argv[i];
+        else { printf("Invalid option: %s\n", argv[i]); printBatchUsage(); return 2; }
+    }
+    if (!file) { printBatchUsage(); return 2; }
+    FILE *report = reportName ? fopen(reportName, "w") : stdout;
+    if (!report) { fprintf(stderr, "Cannot write %s\n", reportName); return 2; }
+    long long lines = 0;
+    long long errors = validateCSVFile(file, threads, report, &lines);
+    if (reportName) fclose(report);
+    if (errors < 0) { fprintf(stderr, "Cannot validate %s\n", file); return 2; }
+    fprintf(stderr, "%s: %lld line(s) checked, %lld error(s).\n", file, lines, errors);
+    return errors == 0 ? 0 : 1;
+}
+
+int runBatchCommand(int argc, char *argv[]) {
+    if (argc < 1) { printBatchUsage(); return 2; }
+    if (strcmp(argv[0], "duplicates") == 0) return batchDuplicates(argc, argv);
+    if (strcmp(argv[0], "workspace") == 0) return batchWorkspace(argc, argv);
+    if (strcmp(argv[0], "totals") == 0) return batchTotals(argc, argv);
+    if (strcmp(argv[0], "validate") == 0) return batchValidate(argc, argv);
+    if (strcmp(argv[0], "export-changes") == 0) return batchExportChanges(argc, argv);
+    printf("Unknown command: %s\n", argv[0]);
+    printBatchUsage();
+    return 2;
+}
+
 int runUnitTests(void) {
 #ifdef _WIN32
     int rc = system("gcc -DUNIT_TEST -o test_payment_unit.exe test_payment_unit.c payment.c");
@@ -1,11 +1,19 @@
 #ifndef PAYMENT_H
 #define PAYMENT_H
 
+#include <stdint.h>
+#include <stdio.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define MAX 100
+#define APPROX_MAX_PATTERN 64
+#define MAX_THREADS 64
+#define RESULT_PAGE_SIZE 10
+#define AGG_SERVICE_SLOTS 16    // known service types + a final "Other" slot
+#define AGG_MONTH_SLOTS 1024
 
 typedef struct {
     char paymentID[10];
@@ -15,12 +23,72 @@ typedef struct {
     char paymentDate[15];
 } Payment;
 
+// Compiled pattern for approximate (edit distance) matching
+typedef struct {
+    uint64_t peq[128];                          // ASCII characters
+    uint32_t extraChar[APPROX_MAX_PATTERN];     // non-ASCII code points in the pattern
+    uint64_t extraMask[APPROX_MAX_PATTERN];
+    int extraCount;
+    int length;                                 // in characters
+} ApproxPattern;
+
+typedef enum {
+    SORT_BY_ID,
+    SORT_BY_AMOUNT,
+    SORT_BY_DATE
+} SortKey;
+
+// One ledger file loaded into its own (unbounded) row array
+typedef struct {
+    char filename[260];
+    Payment *rows;
+    int count;
+    int loaded;
+} Ledger;
+
+// Workspace filters; NULL fields match anything
+typedef struct {
+    const char *payerName;   // case-insensitive substring
+    const char *paymentID;   // case-insensitive exact
+    const char *serviceType; // case-insensitive exact
+} LedgerQuery;
+
+typedef struct {
+    int ledger;
+    int row;
+} LedgerHit;
+
+typedef struct {
+    int count;
+    double sum;
+    float min;
+    float max;
+} LedgerTotals;
+
+// One materialized aggregate (count/sum/min/max of amount)
+typedef struct {
+    int count;
+    double sum;
+    float min;
+    float max;
+    int stale;   // min/max must be rescanned before use
+} AggregateCell;
+
+// Two rows (indexes into the scanned array) that look like a double charge
+typedef struct {
+    int first;
+    int second;
+    int daysApart;
+} DuplicatePair;
+
 extern Payment payments[];
 extern int count;
+extern const char *dataFile;
 extern const char *serviceTypes[];
 extern int serviceTypeCount;
 
 void loadCSV(const char *filename);
+int loadPaymentFile(const char *filename, Payment **outRows);
 void saveCSV(const char *filename);
 void addPayment(void);
 void searchPayment(void);
@@ -29,10 +97,51 @@ void deletePayment(void);
 void displayMenu(void);
 int daysInMonth(int year, int month);
 void toLower(char *s);
+uint32_t utf8FoldCodePoint(uint32_t cp);
+size_t utf8FoldCase(const char *in, size_t len, char *out);
+size_t utf8ClampLength(const char *s, size_t maxBytes);
+void utf8TrimIncomplete(char *s);
 int containsIgnoreCase(const char *text, const char *pattern);
+void approxCompile(ApproxPattern *ap, const char *pattern);
+int approxDistance(const ApproxPattern *ap, const char *text, int maxDist);
 int findServiceMatches(const char *input, int matchedIndexes[]);
 int generateNextPaymentID(char outID[10]);
 int comparePayment(const void *a, const void *b);
+int comparePaymentBy(const Payment *a, const Payment *b, SortKey key);
+void sortPaymentIndexes(const Payment *rows, int *indexes, int n, SortKey key, int descending);
+int topKPayments(const Payment *rows, int n, const char *serviceType, SortKey key, int k, int outIndexes[]);
+int defaultThreadCount(void);
+
+// Reports
+int findDuplicatePayments(const Payment *rows, int n, int windowDays, int threads, DuplicatePair **out);
+void duplicateReport(void);
+
+// Change data capture (append-only "<ledger>.changes" log)
+int recordChange(char op, const Payment *p);
+long long lastChangeSequence(const char *logFile);
+long long exportChanges(const char *logFile, long long since, int compact, FILE *out, int *rowsOut);
+
+// Materialized aggregates per service type and per month
+void rebuildAggregates(void);
+void aggregateAdd(const Payment *p);
+void aggregateRemove(const Payment *p);
+AggregateCell serviceAggregate(int serviceIndex);
+AggregateCell monthAggregate(int year, int month);
+int verifyAggregates(int verbose);
+void showAggregates(void);
+
+// Validate-only (lint) check of a ledger file; returns the error count or -1
+long long validateCSVFile(const char *filename, int threads, FILE *report, long long *linesChecked);
+
+// Multi-ledger workspace
+int openLedger(Ledger *lg, const char *filename);
+void closeLedger(Ledger *lg);
+int openWorkspace(Ledger *ledgers, const char *const filenames[], int n, int threads);
+int workspaceSearch(const Ledger *ledgers, int n, const LedgerQuery *query, SortKey key, int threads, LedgerHit **out);
+int workspaceTotals(const Ledger *ledgers, int n, int threads, LedgerTotals out[]);
+
+// Batch (command-line) entry point; argv[0] is the command name
+int runBatchCommand(int argc, char *argv[]);
 
 // Test helpers exposed to menu (UI)
 int runUnitTests(void);
@@ -23,11 +23,15 @@ function Assert-True {
   }
 }
 
-# Backup existing CSV to isolate test run
+# Backup existing CSV and change log to isolate test run
 if (Test-Path -LiteralPath 'paymentinfo.csv') {
   if (Test-Path -LiteralPath 'paymentinfo_backup.csv') { Remove-Item -Force 'paymentinfo_backup.csv' }
   Rename-Item -LiteralPath 'paymentinfo.csv' -NewName 'paymentinfo_backup.csv'
 }
+if (Test-Path -LiteralPath 'paymentinfo_backup.csv.changes') { Remove-Item -Force 'paymentinfo_backup.csv.changes' }
+if (Test-Path -LiteralPath 'paymentinfo.csv.changes') {
+  Rename-Item -LiteralPath 'paymentinfo.csv.changes' -NewName 'paymentinfo_backup.csv.changes'
+}
 
 Start-Test 'Add payment through main menu'
 
@@ -67,6 +71,10 @@ if (Test-Path -LiteralPath 'paymentinfo_backup.csv') {
   if (Test-Path -LiteralPath 'paymentinfo.csv') { Remove-Item -Force 'paymentinfo.csv' }
   Rename-Item -LiteralPath 'paymentinfo_backup.csv' -NewName 'paymentinfo.csv'
 }
+Remove-Item -Force 'paymentinfo.csv.changes' -ErrorAction SilentlyContinue
+if (Test-Path -LiteralPath 'paymentinfo_backup.csv.changes') {
+  Rename-Item -LiteralPath 'paymentinfo_backup.csv.changes' -NewName 'paymentinfo.csv.changes'
+}
 
 # Summary
 Write-Host ("E2E Summary: {0} passed, {1} failed, {2} total." -f $script:TestsPassed, $script:TestsFailed, $script:TestsTotal)
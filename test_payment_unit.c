@@ -35,18 +35,34 @@ static int file_exists(const char *path) {
 }
 
 static int backup_csv(void) {
+    // The change log is moved aside too so test mutations never reach it
+    remove("paymentinfo_backup.csv.changes");
+    if (file_exists("paymentinfo.csv.changes"))
+        rename("paymentinfo.csv.changes", "paymentinfo_backup.csv.changes");
     if (!file_exists("paymentinfo.csv")) return 0;
     remove("paymentinfo_backup.csv");
     return rename("paymentinfo.csv", "paymentinfo_backup.csv") == 0;
 }
 
 static void restore_csv(void) {
+    remove("paymentinfo.csv.changes");
+    if (file_exists("paymentinfo_backup.csv.changes"))
+        rename("paymentinfo_backup.csv.changes", "paymentinfo.csv.changes");
     if (file_exists("paymentinfo_backup.csv")) {
         remove("paymentinfo.csv");
         rename("paymentinfo_backup.csv", "paymentinfo.csv");
     }
 }
 
+static int count_lines(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int n = 0, c;
+    while ((c = fgetc(f)) != EOF) if (c == '\n') n++;
+    fclose(f);
+    return n;
+}
+
 static void write_input_file(const char *path, const char *content) {
     FILE *f = fopen(path, "w");
     assert(f != NULL);
@@ -88,6 +104,66 @@ static void test_containsIgnoreCase(void) {
     expect_true(containsIgnoreCase("Sample", "z") == 0, "non-existing substring returns 0");
 }
 
+static void test_utf8_case_folding(void) {
+    start_test("UTF-8 case folding");
+    char s[64];
+    strcpy(s, "\xC3\x80\xC3\x89 Stra\xC3\x9F" "e \xD0\x9F\xD0\xA0\xD0\x98 \xCE\xA9");   // "ÀÉ Straße ПРИ Ω"
+    toLower(s);
+    expect_true(strcmp(s, "\xC3\xA0\xC3\xA9 stra\xC3\x9F" "e \xD0\xBF\xD1\x80\xD0\xB8 \xCF\x89") == 0,
+                "Latin-1, Cyrillic and Greek capitals folded in place");
+    expect_true(containsIgnoreCase("\xD0\x98\xD0\x92\xD0\x90\xD0\x9D Petrov", "\xD0\xB8\xD0\xB2\xD0\xB0\xD0\xBD"),
+                "Cyrillic match ignores case");
+    expect_true(containsIgnoreCase("\xCE\x86\xCE\xBD\xCE\xBD\xCE\xB1", "\xCE\xAC\xCE\xBD") == 1,
+                "accented Greek capital folded");   // "Άννα" contains "άν"
+    expect_true(containsIgnoreCase("\xD2\x90", "\xD2\x91") == 1, "Ukrainian Ghe with upturn folded");   // Ґ / ґ
+    expect_true(utf8FoldCodePoint(0x038F) == 0x03CE && utf8FoldCodePoint(0x04C1) == 0x04C2 &&
+                utf8FoldCodePoint(0x04C2) == 0x04C2 && utf8FoldCodePoint(0x04C0) == 0x04CF,
+                "Greek and Cyrillic extended capitals map to their lowercase");
+    // "สมชาย ใจดี" contains "ใจดี"
+    expect_true(containsIgnoreCase("\xE0\xB8\xAA\xE0\xB8\xA1\xE0\xB8\x8A\xE0\xB8\xB2\xE0\xB8\xA2 "
+                                   "\xE0\xB9\x83\xE0\xB8\x88\xE0\xB8\x94\xE0\xB8\xB5",
+                                   "\xE0\xB9\x83\xE0\xB8\x88\xE0\xB8\x94\xE0\xB8\xB5"), "Thai substring found");
+
+    char longText[300];
+    memset(longText, 'a', 250);
+    strcpy(longText + 250, "NEEDLE");
+    expect_true(containsIgnoreCase(longText, "needle") == 1, "text longer than old 100-byte buffer is not truncated");
+
+    strcpy(s, "\xE0\xB8\xAA\xE0\xB8");   // Thai char followed by 2 of 3 bytes
+    utf8TrimIncomplete(s);
+    expect_true(strcmp(s, "\xE0\xB8\xAA") == 0, "cut-off trailing character removed");
+    expect_true(utf8ClampLength("\xE0\xB8\xAA\xE0\xB8\xA1", 4) == 3, "clamp never splits a character");
+
+    ApproxPattern ap;
+    approxCompile(&ap, "\xE0\xB8\xAA\xE0\xB8\xA1\xE0\xB8\x8A\xE0\xB8\xB2\xE0\xB8\xA2");   // สมชาย
+    expect_true(ap.length == 5, "pattern length counted in characters");
+    expect_true(approxDistance(&ap, "\xE0\xB8\xAA\xE0\xB8\xA1\xE0\xB8\x8B\xE0\xB8\xB2\xE0\xB8\xA2", 1) == 1,
+                "one wrong Thai character costs one edit");
+
+    // Invalid bytes are left alone, never folded into a different byte
+    strcpy(s, "AB\xC3");
+    toLower(s);
+    expect_true(strcmp(s, "ab\xC3") == 0, "stray lead byte kept unchanged");
+    expect_true(containsIgnoreCase("x\xC3", "\xE3") == 0, "stray byte does not match its folded neighbour");
+    approxCompile(&ap, "\xE3");
+    expect_true(approxDistance(&ap, "\xC3\xA3", 0) == -1, "stray byte does not match a real character");
+    expect_true(approxDistance(&ap, "x\xE3", 0) == 0, "stray byte matches the same byte");
+}
+
+static void test_approxDistance(void) {
+    start_test("approxDistance");
+    ApproxPattern ap;
+    approxCompile(&ap, "Jonh Doe");
+    expect_true(approxDistance(&ap, "John Doe", 2) == 2, "transposed letters cost 2 edits");
+    expect_true(approxDistance(&ap, "John Doe", 1) == -1, "rejected when above max distance");
+    approxCompile(&ap, "SMITH");
+    expect_true(approxDistance(&ap, "Jane Smith", 0) == 0, "exact match is case-insensitive");
+    approxCompile(&ap, "smth");
+    expect_true(approxDistance(&ap, "Emma Smith", 1) == 1, "missing letter matches inside name");
+    approxCompile(&ap, "");
+    expect_true(approxDistance(&ap, "Anyone", 0) == 0, "empty pattern matches everything");
+}
+
 static void test_findServiceMatches(void) {
     start_test("findServiceMatches");
     int idx[8];
@@ -123,6 +199,71 @@ static void test_generateNextPaymentID(void) {
     expect_true(strcmp(id, "P002") == 0, "next ID should be P002");
 }
 
+static void test_findDuplicatePayments(void) {
+    start_test("findDuplicatePayments");
+    Payment rows[4];
+    memset(rows, 0, sizeof(rows));
+    strcpy(rows[0].paymentID, "P001"); strcpy(rows[0].payerName, "John Doe");
+    rows[0].amount = 500.0f; strcpy(rows[0].paymentDate, "2025-02-27");
+    strcpy(rows[1].paymentID, "P002"); strcpy(rows[1].payerName, "Jane Roe");
+    rows[1].amount = 500.0f; strcpy(rows[1].paymentDate, "2025-02-28");
+    strcpy(rows[2].paymentID, "P003"); strcpy(rows[2].payerName, " john  DOE");
+    rows[2].amount = 500.0f; strcpy(rows[2].paymentDate, "2025-03-02");
+    strcpy(rows[3].paymentID, "P004"); strcpy(rows[3].payerName, "John Doe");
+    rows[3].amount = 500.0f; strcpy(rows[3].paymentDate, "2025-03-20");
+
+    DuplicatePair *pairs = NULL;
+    int n = findDuplicatePayments(rows, 4, 3, 1, &pairs);
+    expect_true(n == 1, "one pair inside a 3 day window");
+    expect_true(n == 1 && pairs[0].first == 0 && pairs[0].second == 2, "pair matches normalized name across month end");
+    expect_true(n == 1 && pairs[0].daysApart == 3, "days apart counted across February");
+    free(pairs);
+
+    n = findDuplicatePayments(rows, 4, 30, 4, &pairs);
+    expect_true(n == 3, "partitioned run finds all pairs in a 30 day window");
+    free(pairs);
+
+    strcpy(rows[0].paymentDate, "1969-12-30");
+    strcpy(rows[2].paymentDate, "1969-12-31");
+    n = findDuplicatePayments(rows, 4, 3, 2, &pairs);
+    expect_true(n == 0, "dates before 2020 are skipped like read_date_ymd rejects them");
+    free(pairs);
+}
+
+static void test_sortPaymentIndexes_and_topK(void) {
+    start_test("sortPaymentIndexes/topKPayments");
+    Payment rows[5];
+    memset(rows, 0, sizeof(rows));
+    const char *svc[5] = {"Internet", "ATM", "Internet", "Internet", "Website"};
+    float amt[5] = {300.0f, 900.0f, 50.0f, 700.0f, 800.0f};
+    for (int i = 0; i < 5; i++) {
+        sprintf(rows[i].paymentID, "P%03d", 5 - i);
+        strcpy(rows[i].serviceType, svc[i]);
+        rows[i].amount = amt[i];
+        sprintf(rows[i].paymentDate, "2025-0%d-01", i + 1);
+    }
+
+    int idx[5] = {0, 1, 2, 3, 4};
+    sortPaymentIndexes(rows, idx, 5, SORT_BY_ID, 0);
+    expect_true(idx[0] == 4 && idx[4] == 0, "sort by ID ascending");
+    sortPaymentIndexes(rows, idx, 5, SORT_BY_AMOUNT, 1);
+    expect_true(idx[0] == 1 && idx[1] == 4 && idx[4] == 2, "sort by amount descending");
+
+    int top[5];
+    int n = topKPayments(rows, 5, "Internet", SORT_BY_AMOUNT, 2, top);
+    expect_true(n == 2 && top[0] == 3 && top[1] == 0, "top 2 Internet payments by amount");
+    n = topKPayments(rows, 5, NULL, SORT_BY_DATE, 10, top);
+    expect_true(n == 5 && top[0] == 4 && top[4] == 0, "top K larger than input returns all, latest first");
+
+    // Equal amounts keep ascending payment ID order when sorting descending
+    rows[0].amount = rows[3].amount = 900.0f;   // P005 and P002 tie with P004
+    for (int i = 0; i < 5; i++) idx[i] = i;
+    sortPaymentIndexes(rows, idx, 5, SORT_BY_AMOUNT, 1);
+    expect_true(idx[0] == 3 && idx[1] == 1 && idx[2] == 0, "descending sort keeps ties in ascending ID order");
+    n = topKPayments(rows, 5, NULL, SORT_BY_AMOUNT, 2, top);
+    expect_true(n == 2 && top[0] == 3 && top[1] == 1, "top K breaks ties by ascending ID");
+}
+
 static void test_save_and_loadCSV(void) {
     start_test("saveCSV/loadCSV");
     reset_state();
@@ -149,6 +290,314 @@ static void test_save_and_loadCSV(void) {
     remove("unit_tmp.csv");
 }
 
+static void test_workspace_fanout(void) {
+    start_test("workspace search/totals");
+    write_input_file("unit_ws_a.csv",
+                     "P001,Alice Smith,Internet,300.00,2024-01-01\n"
+                     "P002,Bob Lee,ATM,50.00,2024-01-02\n");
+    write_input_file("unit_ws_b.csv",
+                     "P001,Carol Smith,ATM,900.00,2024-02-01\n"
+                     "P003,Smithy Jones,Website,10.00,2024-02-02\n");
+    const char *files[3] = {"unit_ws_a.csv", "unit_ws_b.csv", "unit_ws_missing.csv"};
+    Ledger ledgers[3];
+    int opened = openWorkspace(ledgers, files, 3, 2);
+    expect_true(opened == 2, "two existing ledgers opened");
+    expect_true(ledgers[0].loaded && ledgers[1].loaded && !ledgers[2].loaded, "missing ledger flagged");
+
+    LedgerQuery q = { "smith", NULL, NULL };
+    LedgerHit *hits = NULL;
+    int n = workspaceSearch(ledgers, 2, &q, SORT_BY_AMOUNT, 3, &hits);
+    expect_true(n == 3, "name search fans out across ledgers");
+    expect_true(n == 3 && hits[0].ledger == 1 && hits[0].row == 1 && hits[2].ledger == 1 && hits[2].row == 0,
+                "hits merged in amount order");
+    free(hits);
+
+    LedgerQuery byId = { NULL, "p001", NULL };
+    n = workspaceSearch(ledgers, 2, &byId, SORT_BY_ID, 1, &hits);
+    expect_true(n == 2 && hits[0].ledger == 0 && hits[1].ledger == 1, "ID lookup returns one hit per ledger");
+    free(hits);
+
+    LedgerTotals totals[2];
+    expect_true(workspaceTotals(ledgers, 2, 4, totals) == 1, "totals computed");
+    expect_true(totals[0].count == 2 && totals[0].sum == 350.0 && totals[1].max == 900.0f, "per-ledger totals correct");
+
+    for (int i = 0; i < 3; i++) closeLedger(&ledgers[i]);
+    remove("unit_ws_a.csv");
+    remove("unit_ws_b.csv");
+}
+
+static void test_change_capture_export(void) {
+    start_test("change log and export-changes");
+    reset_state();
+    backup_csv();
+    write_input_file("unit_in_cdc.txt",
+                    "Dana Kim\n"
+                    "ATM\n"
+                    "250\n"
+                    "2024-05-01\n");
+    redirect_stdin("unit_in_cdc.txt");
+    addPayment();
+    restore_stdin_null();
+    write_input_file("unit_in_cdc.txt", "P001\n3\n300\n0\n");
+    redirect_stdin("unit_in_cdc.txt");
+    updatePayment();
+    restore_stdin_null();
+    write_input_file("unit_in_cdc.txt", "P001\n");
+    redirect_stdin("unit_in_cdc.txt");
+    deletePayment();
+    restore_stdin_null();
+    remove("unit_in_cdc.txt");
+
+    expect_true(lastChangeSequence("paymentinfo.csv.changes") == 3, "three changes stamped 1..3");
+
+    FILE *out = fopen("unit_cdc_out.txt", "w");
+    int rows = 0;
+    long long high = exportChanges("paymentinfo.csv.changes", 1, 0, out, &rows);
+    fclose(out);
+    expect_true(high == 3 && rows == 2, "export since seq 1 returns the update and delete");
+    expect_true(count_lines("unit_cdc_out.txt") == 2, "exported file has two rows");
+
+    out = fopen("unit_cdc_out.txt", "w");
+    high = exportChanges("paymentinfo.csv.changes", 0, 1, out, &rows);
+    fclose(out);
+    char line[128] = "";
+    FILE *in = fopen("unit_cdc_out.txt", "r");
+    if (in) { if (!fgets(line, sizeof(line), in)) line[0] = '\0'; fclose(in); }
+    expect_true(high == 3 && rows == 1 && strcmp(line, "3,D,P001\n") == 0, "compact export keeps only the final delete");
+
+    out = fopen("unit_cdc_out.txt", "w");
+    high = exportChanges("paymentinfo.csv.changes", 3, 0, out, &rows);
+    fclose(out);
+    expect_true(high == 3 && rows == 0, "nothing to export at the latest checkpoint");
+    remove("unit_cdc_out.txt");
+    restore_csv();
+}
+
+static void test_change_log_torn_tail(void) {
+    start_test("change log with a torn last line");
+    reset_state();
+    backup_csv();
+    write_input_file("paymentinfo.csv.changes",
+                    "40,I,P001,A,ATM,100.00,2024-01-01\n"
+                    "41,U,P001,A,ATM,150.00,2024-01-01\n"
+                    "garbage\n"
+                    "4");
+    expect_true(lastChangeSequence("paymentinfo.csv.changes") == 41, "sequence taken from the last well-formed entry");
+
+    Payment p = { "P002", "B", "ATM", 200.0f, "2024-02-01" };
+    expect_true(recordChange('I', &p) == 1, "change appended after a torn line");
+    expect_true(lastChangeSequence("paymentinfo.csv.changes") == 42, "new entry continues the sequence");
+    expect_true(count_lines("paymentinfo.csv.changes") == 4, "torn line dropped before the new entry");
+
+    FILE *out = fopen("unit_cdc_out.txt", "w");
+    int rows = 0;
+    long long high = exportChanges("paymentinfo.csv.changes", 41, 0, out, &rows);
+    fclose(out);
+    char line[128] = "";
+    FILE *in = fopen("unit_cdc_out.txt", "r");
+    if (in) { if (!fgets(line, sizeof(line), in)) line[0] = '\0'; fclose(in); }
+    expect_true(high == 42 && rows == 1 && strncmp(line, "42,I,P002,", 10) == 0, "export skips garbled lines");
+
+    // Torn after its last comma: must not be completed into an entry
+    write_input_file("paymentinfo.csv.changes",
+                    "1,I,P001,A,ATM,100.00,2024-01-01\n"
+                    "2,U,P001,A,ATM,150.00,2024-0");
+    expect_true(recordChange('I', &p) == 1, "change appended after a torn entry");
+    expect_true(count_lines("paymentinfo.csv.changes") == 2, "torn entry dropped, not completed");
+    for (int compact = 0; compact < 2; compact++) {
+        out = fopen("unit_cdc_out.txt", "w");
+        high = exportChanges("paymentinfo.csv.changes", 1, compact, out, &rows);
+        fclose(out);
+        line[0] = '\0';
+        in = fopen("unit_cdc_out.txt", "r");
+        if (in) { if (!fgets(line, sizeof(line), in)) line[0] = '\0'; fclose(in); }
+        expect_true(high == 2 && rows == 1 && strcmp(line, "2,I,P002,B,ATM,200.00,2024-02-01\n") == 0,
+                    compact ? "compact export sees only the new seq 2" : "export sees only the new seq 2");
+    }
+    remove("unit_cdc_out.txt");
+    restore_csv();
+}
+
+static void test_materialized_aggregates(void) {
+    start_test("materialized aggregates");
+    reset_state();
+    backup_csv();
+    strcpy(payments[0].paymentID, "P001"); strcpy(payments[0].payerName, "A");
+    strcpy(payments[0].serviceType, "ATM"); payments[0].amount = 100.0f;
+    strcpy(payments[0].paymentDate, "2024-01-05");
+    strcpy(payments[1].paymentID, "P002"); strcpy(payments[1].payerName, "B");
+    strcpy(payments[1].serviceType, "ATM"); payments[1].amount = 900.0f;
+    strcpy(payments[1].paymentDate, "2024-01-20");
+    count = 2;
+    rebuildAggregates();
+    int atm = 4;   // serviceTypes[4] == "ATM"
+    AggregateCell c = serviceAggregate(atm);
+    expect_true(c.count == 2 && c.sum == 1000.0 && c.min == 100.0f && c.max == 900.0f, "rebuilt ATM totals");
+
+    write_input_file("unit_in_agg.txt", "C\nATM\n50\n2024-02-01\n");
+    redirect_stdin("unit_in_agg.txt");
+    addPayment();
+    restore_stdin_null();
+    c = serviceAggregate(atm);
+    expect_true(c.count == 3 && c.min == 50.0f, "add adjusts count and min");
+    expect_true(monthAggregate(2024, 2).count == 1, "add creates the new month");
+
+    write_input_file("unit_in_agg.txt", "P002\n3\n200\n0\n");
+    redirect_stdin("unit_in_agg.txt");
+    updatePayment();
+    restore_stdin_null();
+    c = serviceAggregate(atm);
+    expect_true(c.count == 3 && c.sum == 350.0 && c.max == 200.0f, "update replaces old amount, max rescanned");
+
+    write_input_file("unit_in_agg.txt", "P003\n");
+    redirect_stdin("unit_in_agg.txt");
+    deletePayment();
+    restore_stdin_null();
+    remove("unit_in_agg.txt");
+    c = serviceAggregate(atm);
+    expect_true(c.count == 2 && c.min == 100.0f, "delete removes row, min rescanned");
+    expect_true(monthAggregate(2024, 2).count == 0, "deleted month drops to zero");
+    expect_true(verifyAggregates(0) == 0, "maintained views match a full recompute");
+
+    strcpy(payments[1].paymentID, "P004"); strcpy(payments[1].payerName, "D");
+    strcpy(payments[1].serviceType, "ATM"); payments[1].amount = 300.0f;
+    strcpy(payments[1].paymentDate, "2024-01-25");
+    count = 2;
+    rebuildAggregates();
+    aggregateRemove(&payments[1]);
+    count = 1;
+    expect_true(verifyAggregates(0) == 0, "stale cell still bounding the extremes passes");
+    count = 2;
+    aggregateAdd(&payments[1]);
+    serviceAggregate(atm);
+    monthAggregate(2024, 1);
+    payments[0].amount = 200.0f;
+    payments[1].amount = 200.0f;   // same count and sum, different extremes
+    expect_true(verifyAggregates(0) == 2, "unhooked change to min/max caught in service and month");
+    restore_csv();
+}
+
+static void test_validateCSVFile(void) {
+    start_test("validateCSVFile");
+    write_input_file("unit_val.csv",
+                     "P001,John Doe,Internet,500.00,2025-08-01\n"
+                     "X12,Bad,ATM,5.00,2024-01-01\n"
+                     "P002,,Atm,0.50,2024-02-30\n"
+                     "P003,Short,ATM\n"
+                     "p001,Again,ATM,10.00,2024-01-01\n");
+    FILE *rep = fopen("unit_val_report.txt", "w");
+    long long lines = 0;
+    long long errors = validateCSVFile("unit_val.csv", 1, rep, &lines);
+    fclose(rep);
+    expect_true(lines == 5, "every line checked");
+    expect_true(errors == 7, "bad ID, empty name, service, amount, date, field count and duplicate reported");
+    expect_true(count_lines("unit_val_report.txt") == 8, "report has header plus one row per error");
+    FILE *in = fopen("unit_val_report.txt", "r");
+    char line[128] = "", last[128] = "";
+    while (in && fgets(line, sizeof(line), in)) strcpy(last, line);
+    if (in) fclose(in);
+    expect_true(strcmp(last, "5,DUPLICATE_ID,p001,first seen on line 1\n") == 0, "duplicate ID points at first occurrence");
+
+    // Large enough to be split into chunks; the duplicate spans chunks
+    FILE *f = fopen("unit_val_big.csv", "w");
+    assert(f != NULL);
+    for (int i = 1; i <= 999; i++) fprintf(f, "P%03d,Name %d,ATM,10.00,2024-01-01\n", i, i);
+    fprintf(f, "P007,Late Duplicate,ATM,10.00,2024-01-01\n");
+    fclose(f);
+    errors = validateCSVFile("unit_val_big.csv", 4, NULL, &lines);
+    expect_true(lines == 1000 && errors == 1, "parallel chunks find the cross-chunk duplicate only");
+    expect_true(validateCSVFile("unit_val_missing.csv", 2, NULL, NULL) == -1, "missing file returns -1");
+
+    // 20 Thai characters, 60 bytes: too long, and the reported value must not split one
+    write_input_file("unit_val.csv",
+                     "P001,\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81"
+                     "\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81"
+                     "\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81"
+                     "\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81,ATM,nan,2024-01-01\n");
+    rep = fopen("unit_val_report.txt", "w");
+    errors = validateCSVFile("unit_val.csv", 1, rep, &lines);
+    fclose(rep);
+    expect_true(errors == 2, "name length and NaN amount both reported");
+    in = fopen("unit_val_report.txt", "r");
+    char rows[3][128] = { "", "", "" };
+    for (int i = 0; i < 3 && in && fgets(rows[i], sizeof(rows[i]), in); i++) {}
+    if (in) fclose(in);
+    expect_true(strcmp(rows[1], "1,NAME_TOO_LONG,\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81"
+                                "\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81,\n") == 0,
+                "long Thai value cut on a character boundary");
+    expect_true(strcmp(rows[2], "1,AMOUNT_RANGE,nan,\n") == 0, "NaN amount reported as out of range");
+
+    // Over-long line whose 20-byte prefix would end inside a Thai character
+    f = fopen("unit_val.csv", "w");
+    assert(f != NULL);
+    fputs("P001,x", f);
+    for (int i = 0; i < 400; i++) fputs("\xE0\xB8\x81", f);
+    fputs(",ATM,10.00,2024-01-01\n", f);
+    fclose(f);
+    rep = fopen("unit_val_report.txt", "w");
+    errors = validateCSVFile("unit_val.csv", 1, rep, &lines);
+    fclose(rep);
+    in = fopen("unit_val_report.txt", "r");
+    rows[1][0] = '\0';
+    for (int i = 0; i < 2 && in && fgets(rows[i], sizeof(rows[i]), in); i++) {}
+    if (in) fclose(in);
+    expect_true(errors == 1 && strcmp(rows[1], "1,LINE_TOO_LONG,P001 x\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81\xE0\xB8\x81,\n") == 0,
+                "long line value cut on a character boundary");
+    remove("unit_val.csv");
+    remove("unit_val_big.csv");
+    remove("unit_val_report.txt");
+}
+
+static void test_save_load_utf8_name(void) {
+    start_test("saveCSV/loadCSV long UTF-8 name");
+    reset_state();
+    strcpy(payments[0].paymentID, "P001");
+    // 16 Thai characters = 48 bytes, fits the 49-byte field exactly
+    payments[0].payerName[0] = '\0';
+    for (int i = 0; i < 16; i++) strcat(payments[0].payerName, "\xE0\xB8\x81");
+    strcpy(payments[0].serviceType, "ATM");
+    payments[0].amount = 10.0f;
+    strcpy(payments[0].paymentDate, "2024-01-01");
+    count = 1;
+    saveCSV("unit_utf8.csv");
+    reset_state();
+    loadCSV("unit_utf8.csv");
+    expect_true(count == 1 && strlen(payments[0].payerName) == 48, "48-byte Thai name survives save/load");
+
+    // 49 bytes behind a formula guard: saved as 50 with the quote, loaded back intact
+    char guarded[50];
+    memset(guarded, 'x', 49);
+    guarded[0] = '=';
+    guarded[49] = '\0';
+    strcpy(payments[0].payerName, guarded);
+    strcpy(payments[1].paymentID, "P002");
+    strcpy(payments[1].payerName, "'quoted");
+    strcpy(payments[1].serviceType, "ATM");
+    payments[1].amount = 20.0f;
+    strcpy(payments[1].paymentDate, "2024-01-02");
+    count = 2;
+    saveCSV("unit_utf8.csv");
+    reset_state();
+    loadCSV("unit_utf8.csv");
+    expect_true(count == 2 && strcmp(payments[0].payerName, guarded) == 0, "49-byte '=' name round-trips");
+    expect_true(strcmp(payments[1].payerName, "'quoted") == 0, "name starting with a quote round-trips");
+
+    // 20 Thai characters = 60 bytes written by another tool: kept, cut to 16 characters
+    FILE *f = fopen("unit_utf8.csv", "w");
+    assert(f != NULL);
+    fputs("P001,", f);
+    for (int i = 0; i < 20; i++) fputs("\xE0\xB8\x81", f);
+    fputs(",ATM,10.00,2024-01-01\n", f);
+    fclose(f);
+    reset_state();
+    loadCSV("unit_utf8.csv");
+    expect_true(count == 1 && strlen(payments[0].payerName) == 48, "overlong Thai name truncated, row kept");
+    expect_true(payments[0].amount == 10.0f && strcmp(payments[0].paymentDate, "2024-01-01") == 0,
+                "fields after the long name still parsed");
+
+    remove("unit_utf8.csv");
+}
+
 static void test_displayMenu_noop(void) {
     start_test("displayMenu (no-op)");
     int before = count;
@@ -202,6 +651,47 @@ static void test_searchPayment_by_id_no_mutation(void) {
     expect_true(strcmp(payments[0].payerName, "Jane Roe") == 0, "record unchanged after search");
 }
 
+static void test_searchPayment_approx_no_mutation(void) {
+    start_test("searchPayment approximate name (no mutation)");
+    reset_state();
+    strcpy(payments[0].paymentID, "P001");
+    strcpy(payments[0].payerName, "John Doe");
+    strcpy(payments[0].serviceType, "Internet");
+    payments[0].amount = 10.0f;
+    strcpy(payments[0].paymentDate, "2024-02-02");
+    count = 1;
+
+    write_input_file("unit_in_search_approx.txt",
+                    "3\n"         // approximate name search
+                    "Jonh Doe\n"
+                    "2\n"         // max typos
+                    "1\n");       // view first hit
+    redirect_stdin("unit_in_search_approx.txt");
+    searchPayment();
+    restore_stdin_null();
+    remove("unit_in_search_approx.txt");
+
+    expect_true(count == 1, "approximate search does not change count");
+    expect_true(strcmp(payments[0].payerName, "John Doe") == 0, "record unchanged after approximate search");
+
+    // 17 Thai characters: cut to the 16 that fit, nothing left over for the next prompt
+    payments[0].payerName[0] = '\0';
+    for (int i = 0; i < 16; i++) strcat(payments[0].payerName, "\xE0\xB8\x81");
+    FILE *f = fopen("unit_in_search_approx.txt", "w");
+    assert(f != NULL);
+    fputs("3\n", f);
+    for (int i = 0; i < 17; i++) fputs("\xE0\xB8\x81", f);
+    fputs("\n0\n0\nMARKER\n", f);   // name, max typos, cancel the result list
+    fclose(f);
+    redirect_stdin("unit_in_search_approx.txt");
+    searchPayment();
+    char next[16] = "";
+    if (!fgets(next, sizeof(next), stdin)) next[0] = '\0';
+    restore_stdin_null();
+    remove("unit_in_search_approx.txt");
+    expect_true(strcmp(next, "MARKER\n") == 0, "long Thai name matched exactly and prompts stay in sync");
+}
+
 static void test_updatePayment_amount(void) {
     start_test("updatePayment amount");
     reset_state();
@@ -255,13 +745,24 @@ int main(void) {
     test_daysInMonth();
     test_toLower();
     test_containsIgnoreCase();
+    test_utf8_case_folding();
+    test_approxDistance();
     test_findServiceMatches();
     test_comparePayment();
     test_generateNextPaymentID();
+    test_findDuplicatePayments();
+    test_sortPaymentIndexes_and_topK();
     test_save_and_loadCSV();
+    test_workspace_fanout();
+    test_change_capture_export();
+    test_change_log_torn_tail();
+    test_materialized_aggregates();
+    test_validateCSVFile();
+    test_save_load_utf8_name();
     test_displayMenu_noop();
     test_addPayment_flow();
     test_searchPayment_by_id_no_mutation();
+    test_searchPayment_approx_no_mutation();
     test_updatePayment_amount();
     test_deletePayment_by_id();
 